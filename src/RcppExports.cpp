@@ -6,6 +6,91 @@
 
 using namespace Rcpp;
 
+// screenCandidateSet
+Eigen::VectorXi screenCandidateSet(const Eigen::MatrixXd& candidatelist, double tolerance, int maxiterations);
+RcppExport SEXP _skpr_screenCandidateSet(SEXP candidatelistSEXP, SEXP toleranceSEXP, SEXP maxiterationsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type candidatelist(candidatelistSEXP);
+    Rcpp::traits::input_parameter< double >::type tolerance(toleranceSEXP);
+    Rcpp::traits::input_parameter< int >::type maxiterations(maxiterationsSEXP);
+    rcpp_result_gen = Rcpp::wrap(screenCandidateSet(candidatelist, tolerance, maxiterations));
+    return rcpp_result_gen;
+END_RCPP
+}
+// approximateOptimalityBound
+double approximateOptimalityBound(const Eigen::MatrixXd& candidatelist, const std::string condition, const Eigen::MatrixXd& momentsmatrix, int trials, double tolerance, int maxiterations);
+RcppExport SEXP _skpr_approximateOptimalityBound(SEXP candidatelistSEXP, SEXP conditionSEXP, SEXP momentsmatrixSEXP, SEXP trialsSEXP, SEXP toleranceSEXP, SEXP maxiterationsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type candidatelist(candidatelistSEXP);
+    Rcpp::traits::input_parameter< const std::string >::type condition(conditionSEXP);
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type momentsmatrix(momentsmatrixSEXP);
+    Rcpp::traits::input_parameter< int >::type trials(trialsSEXP);
+    Rcpp::traits::input_parameter< double >::type tolerance(toleranceSEXP);
+    Rcpp::traits::input_parameter< int >::type maxiterations(maxiterationsSEXP);
+    rcpp_result_gen = Rcpp::wrap(approximateOptimalityBound(candidatelist, condition, momentsmatrix, trials, tolerance, maxiterations));
+    return rcpp_result_gen;
+END_RCPP
+}
+// candidateModelMatrices
+List candidateModelMatrices(const Eigen::MatrixXi& levelindices, List models);
+RcppExport SEXP _skpr_candidateModelMatrices(SEXP levelindicesSEXP, SEXP modelsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Eigen::MatrixXi& >::type levelindices(levelindicesSEXP);
+    Rcpp::traits::input_parameter< List >::type models(modelsSEXP);
+    rcpp_result_gen = Rcpp::wrap(candidateModelMatrices(levelindices, models));
+    return rcpp_result_gen;
+END_RCPP
+}
+// createDesignSession
+SEXP createDesignSession(NumericMatrix candidatelist, NumericMatrix aliascandidatelist, const std::string condition, const Eigen::MatrixXd& momentsmatrix, Nullable<NumericMatrix> V, double minDopt, double tolerance, int kexchange);
+RcppExport SEXP _skpr_createDesignSession(SEXP candidatelistSEXP, SEXP aliascandidatelistSEXP, SEXP conditionSEXP, SEXP momentsmatrixSEXP, SEXP VSEXP, SEXP minDoptSEXP, SEXP toleranceSEXP, SEXP kexchangeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericMatrix >::type candidatelist(candidatelistSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type aliascandidatelist(aliascandidatelistSEXP);
+    Rcpp::traits::input_parameter< const std::string >::type condition(conditionSEXP);
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type momentsmatrix(momentsmatrixSEXP);
+    Rcpp::traits::input_parameter< Nullable<NumericMatrix> >::type V(VSEXP);
+    Rcpp::traits::input_parameter< double >::type minDopt(minDoptSEXP);
+    Rcpp::traits::input_parameter< double >::type tolerance(toleranceSEXP);
+    Rcpp::traits::input_parameter< int >::type kexchange(kexchangeSEXP);
+    rcpp_result_gen = Rcpp::wrap(createDesignSession(candidatelist, aliascandidatelist, condition, momentsmatrix, V, minDopt, tolerance, kexchange));
+    return rcpp_result_gen;
+END_RCPP
+}
+// runDesignSession
+List runDesignSession(SEXP session, Eigen::VectorXi initialRows, const Eigen::MatrixXd& augmentdesign);
+RcppExport SEXP _skpr_runDesignSession(SEXP sessionSEXP, SEXP initialRowsSEXP, SEXP augmentdesignSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    Rcpp::traits::input_parameter< Eigen::VectorXi >::type initialRows(initialRowsSEXP);
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type augmentdesign(augmentdesignSEXP);
+    rcpp_result_gen = Rcpp::wrap(runDesignSession(session, initialRows, augmentdesign));
+    return rcpp_result_gen;
+END_RCPP
+}
+// waldEffectPvalues
+Eigen::MatrixXd waldEffectPvalues(const Eigen::MatrixXd& estimates, List covariances, List hypotheses);
+RcppExport SEXP _skpr_waldEffectPvalues(SEXP estimatesSEXP, SEXP covariancesSEXP, SEXP hypothesesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type estimates(estimatesSEXP);
+    Rcpp::traits::input_parameter< List >::type covariances(covariancesSEXP);
+    Rcpp::traits::input_parameter< List >::type hypotheses(hypothesesSEXP);
+    rcpp_result_gen = Rcpp::wrap(waldEffectPvalues(estimates, covariances, hypotheses));
+    return rcpp_result_gen;
+END_RCPP
+}
 // DOptimality
 double DOptimality(const Eigen::MatrixXd& currentDesign);
 RcppExport SEXP _skpr_DOptimality(SEXP currentDesignSEXP) {
@@ -144,19 +229,181 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// designCriteria
+List designCriteria(List designs, Nullable<NumericMatrix> momentsmatrix, Nullable<NumericMatrix> V, Nullable<List> aliasmatrices);
+RcppExport SEXP _skpr_designCriteria(SEXP designsSEXP, SEXP momentsmatrixSEXP, SEXP VSEXP, SEXP aliasmatricesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type designs(designsSEXP);
+    Rcpp::traits::input_parameter< Nullable<NumericMatrix> >::type momentsmatrix(momentsmatrixSEXP);
+    Rcpp::traits::input_parameter< Nullable<NumericMatrix> >::type V(VSEXP);
+    Rcpp::traits::input_parameter< Nullable<List> >::type aliasmatrices(aliasmatricesSEXP);
+    rcpp_result_gen = Rcpp::wrap(designCriteria(designs, momentsmatrix, V, aliasmatrices));
+    return rcpp_result_gen;
+END_RCPP
+}
+// designSessionCriteria
+List designSessionCriteria(SEXP session, List designs, Nullable<List> aliasmatrices);
+RcppExport SEXP _skpr_designSessionCriteria(SEXP sessionSEXP, SEXP designsSEXP, SEXP aliasmatricesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    Rcpp::traits::input_parameter< List >::type designs(designsSEXP);
+    Rcpp::traits::input_parameter< Nullable<List> >::type aliasmatrices(aliasmatricesSEXP);
+    rcpp_result_gen = Rcpp::wrap(designSessionCriteria(session, designs, aliasmatrices));
+    return rcpp_result_gen;
+END_RCPP
+}
+// exchangeSearch
+List exchangeSearch(const Eigen::MatrixXd& design, const Eigen::MatrixXd& candidatelist, int row, const std::string condition);
+RcppExport SEXP _skpr_exchangeSearch(SEXP designSEXP, SEXP candidatelistSEXP, SEXP rowSEXP, SEXP conditionSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type design(designSEXP);
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type candidatelist(candidatelistSEXP);
+    Rcpp::traits::input_parameter< int >::type row(rowSEXP);
+    Rcpp::traits::input_parameter< const std::string >::type condition(conditionSEXP);
+    rcpp_result_gen = Rcpp::wrap(exchangeSearch(design, candidatelist, row, condition));
+    return rcpp_result_gen;
+END_RCPP
+}
+// dExchangePass
+List dExchangePass(Eigen::MatrixXd design, const Eigen::MatrixXd& candidatelist);
+RcppExport SEXP _skpr_dExchangePass(SEXP designSEXP, SEXP candidatelistSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Eigen::MatrixXd >::type design(designSEXP);
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type candidatelist(candidatelistSEXP);
+    rcpp_result_gen = Rcpp::wrap(dExchangePass(design, candidatelist));
+    return rcpp_result_gen;
+END_RCPP
+}
+// predictionVariances
+Eigen::VectorXd predictionVariances(const Eigen::MatrixXd& designmm, const Eigen::MatrixXd& V, const Eigen::MatrixXd& points, int blocksize);
+RcppExport SEXP _skpr_predictionVariances(SEXP designmmSEXP, SEXP VSEXP, SEXP pointsSEXP, SEXP blocksizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type designmm(designmmSEXP);
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type V(VSEXP);
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type points(pointsSEXP);
+    Rcpp::traits::input_parameter< int >::type blocksize(blocksizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(predictionVariances(designmm, V, points, blocksize));
+    return rcpp_result_gen;
+END_RCPP
+}
+// fdsPredictionVariances
+Eigen::VectorXd fdsPredictionVariances(const Eigen::MatrixXd& designmm, const Eigen::MatrixXd& V, IntegerVector levelcounts, List terms, bool intercept, int npoints, int blocksize);
+RcppExport SEXP _skpr_fdsPredictionVariances(SEXP designmmSEXP, SEXP VSEXP, SEXP levelcountsSEXP, SEXP termsSEXP, SEXP interceptSEXP, SEXP npointsSEXP, SEXP blocksizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type designmm(designmmSEXP);
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type V(VSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type levelcounts(levelcountsSEXP);
+    Rcpp::traits::input_parameter< List >::type terms(termsSEXP);
+    Rcpp::traits::input_parameter< bool >::type intercept(interceptSEXP);
+    Rcpp::traits::input_parameter< int >::type npoints(npointsSEXP);
+    Rcpp::traits::input_parameter< int >::type blocksize(blocksizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(fdsPredictionVariances(designmm, V, levelcounts, terms, intercept, npoints, blocksize));
+    return rcpp_result_gen;
+END_RCPP
+}
+// gEfficiencyMaximum
+List gEfficiencyMaximum(const Eigen::MatrixXd& designmm, int numericcount, IntegerVector levelcounts, List terms, bool intercept, int starts, int maxiterations, int threads);
+RcppExport SEXP _skpr_gEfficiencyMaximum(SEXP designmmSEXP, SEXP numericcountSEXP, SEXP levelcountsSEXP, SEXP termsSEXP, SEXP interceptSEXP, SEXP startsSEXP, SEXP maxiterationsSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type designmm(designmmSEXP);
+    Rcpp::traits::input_parameter< int >::type numericcount(numericcountSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type levelcounts(levelcountsSEXP);
+    Rcpp::traits::input_parameter< List >::type terms(termsSEXP);
+    Rcpp::traits::input_parameter< bool >::type intercept(interceptSEXP);
+    Rcpp::traits::input_parameter< int >::type starts(startsSEXP);
+    Rcpp::traits::input_parameter< int >::type maxiterations(maxiterationsSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(gEfficiencyMaximum(designmm, numericcount, levelcounts, terms, intercept, starts, maxiterations, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// continuousModelRows
+Eigen::MatrixXd continuousModelRows(const Eigen::MatrixXd& x, const Eigen::MatrixXi& levelindices, IntegerVector levelcounts, List terms, bool intercept);
+RcppExport SEXP _skpr_continuousModelRows(SEXP xSEXP, SEXP levelindicesSEXP, SEXP levelcountsSEXP, SEXP termsSEXP, SEXP interceptSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type x(xSEXP);
+    Rcpp::traits::input_parameter< const Eigen::MatrixXi& >::type levelindices(levelindicesSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type levelcounts(levelcountsSEXP);
+    Rcpp::traits::input_parameter< List >::type terms(termsSEXP);
+    Rcpp::traits::input_parameter< bool >::type intercept(interceptSEXP);
+    rcpp_result_gen = Rcpp::wrap(continuousModelRows(x, levelindices, levelcounts, terms, intercept));
+    return rcpp_result_gen;
+END_RCPP
+}
+// gaussianMonteCarlo
+List gaussianMonteCarlo(const Eigen::MatrixXd& X, const Eigen::MatrixXd& responses, List hypotheses);
+RcppExport SEXP _skpr_gaussianMonteCarlo(SEXP XSEXP, SEXP responsesSEXP, SEXP hypothesesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type responses(responsesSEXP);
+    Rcpp::traits::input_parameter< List >::type hypotheses(hypothesesSEXP);
+    rcpp_result_gen = Rcpp::wrap(gaussianMonteCarlo(X, responses, hypotheses));
+    return rcpp_result_gen;
+END_RCPP
+}
+// genFactorialOptimalDesign
+List genFactorialOptimalDesign(IntegerVector levelcounts, List terms, bool intercept, const Eigen::MatrixXi& disallowed, int trials, double tolerance, int tilesize, int samplesize);
+RcppExport SEXP _skpr_genFactorialOptimalDesign(SEXP levelcountsSEXP, SEXP termsSEXP, SEXP interceptSEXP, SEXP disallowedSEXP, SEXP trialsSEXP, SEXP toleranceSEXP, SEXP tilesizeSEXP, SEXP samplesizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< IntegerVector >::type levelcounts(levelcountsSEXP);
+    Rcpp::traits::input_parameter< List >::type terms(termsSEXP);
+    Rcpp::traits::input_parameter< bool >::type intercept(interceptSEXP);
+    Rcpp::traits::input_parameter< const Eigen::MatrixXi& >::type disallowed(disallowedSEXP);
+    Rcpp::traits::input_parameter< int >::type trials(trialsSEXP);
+    Rcpp::traits::input_parameter< double >::type tolerance(toleranceSEXP);
+    Rcpp::traits::input_parameter< int >::type tilesize(tilesizeSEXP);
+    Rcpp::traits::input_parameter< int >::type samplesize(samplesizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(genFactorialOptimalDesign(levelcounts, terms, intercept, disallowed, trials, tolerance, tilesize, samplesize));
+    return rcpp_result_gen;
+END_RCPP
+}
+// factorialCandidateRows
+Eigen::MatrixXd factorialCandidateRows(IntegerVector levelcounts, List terms, bool intercept, NumericVector indices);
+RcppExport SEXP _skpr_factorialCandidateRows(SEXP levelcountsSEXP, SEXP termsSEXP, SEXP interceptSEXP, SEXP indicesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< IntegerVector >::type levelcounts(levelcountsSEXP);
+    Rcpp::traits::input_parameter< List >::type terms(termsSEXP);
+    Rcpp::traits::input_parameter< bool >::type intercept(interceptSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type indices(indicesSEXP);
+    rcpp_result_gen = Rcpp::wrap(factorialCandidateRows(levelcounts, terms, intercept, indices));
+    return rcpp_result_gen;
+END_RCPP
+}
 // genOptimalDesign
-List genOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixXd& candidatelist, const std::string condition, const Eigen::MatrixXd& momentsmatrix, Eigen::VectorXd initialRows, Eigen::MatrixXd aliasdesign, const Eigen::MatrixXd& aliascandidatelist, double minDopt, double tolerance, int augmentedrows, int kexchange);
+List genOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::Map<Eigen::MatrixXd> candidatelist, const std::string condition, const Eigen::MatrixXd& momentsmatrix, Eigen::VectorXd initialRows, Eigen::MatrixXd aliasdesign, const Eigen::Map<Eigen::MatrixXd> aliascandidatelist, double minDopt, double tolerance, int augmentedrows, int kexchange);
 RcppExport SEXP _skpr_genOptimalDesign(SEXP initialdesignSEXP, SEXP candidatelistSEXP, SEXP conditionSEXP, SEXP momentsmatrixSEXP, SEXP initialRowsSEXP, SEXP aliasdesignSEXP, SEXP aliascandidatelistSEXP, SEXP minDoptSEXP, SEXP toleranceSEXP, SEXP augmentedrowsSEXP, SEXP kexchangeSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< Eigen::MatrixXd >::type initialdesign(initialdesignSEXP);
-    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type candidatelist(candidatelistSEXP);
+    Rcpp::traits::input_parameter< const Eigen::Map<Eigen::MatrixXd> >::type candidatelist(candidatelistSEXP);
     Rcpp::traits::input_parameter< const std::string >::type condition(conditionSEXP);
     Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type momentsmatrix(momentsmatrixSEXP);
     Rcpp::traits::input_parameter< Eigen::VectorXd >::type initialRows(initialRowsSEXP);
     Rcpp::traits::input_parameter< Eigen::MatrixXd >::type aliasdesign(aliasdesignSEXP);
-    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type aliascandidatelist(aliascandidatelistSEXP);
+    Rcpp::traits::input_parameter< const Eigen::Map<Eigen::MatrixXd> >::type aliascandidatelist(aliascandidatelistSEXP);
     Rcpp::traits::input_parameter< double >::type minDopt(minDoptSEXP);
     Rcpp::traits::input_parameter< double >::type tolerance(toleranceSEXP);
     Rcpp::traits::input_parameter< int >::type augmentedrows(augmentedrowsSEXP);
@@ -166,20 +413,20 @@ BEGIN_RCPP
 END_RCPP
 }
 // genSplitPlotOptimalDesign
-List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd candidatelist, const Eigen::MatrixXd& blockeddesign, const std::string condition, const Eigen::MatrixXd& momentsmatrix, Eigen::VectorXi& initialRows, const Eigen::MatrixXd& blockedVar, Eigen::MatrixXd aliasdesign, Eigen::MatrixXd aliascandidatelist, double minDopt, List interactions, const Eigen::MatrixXd disallowed, const bool anydisallowed, double tolerance, int kexchange);
+List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::Map<Eigen::MatrixXd> candidatelist, const Eigen::MatrixXd& blockeddesign, const std::string condition, const Eigen::MatrixXd& momentsmatrix, Eigen::VectorXi& initialRows, const Eigen::MatrixXd& blockedVar, Eigen::MatrixXd aliasdesign, const Eigen::Map<Eigen::MatrixXd> aliascandidatelist, double minDopt, List interactions, const Eigen::MatrixXd disallowed, const bool anydisallowed, double tolerance, int kexchange);
 RcppExport SEXP _skpr_genSplitPlotOptimalDesign(SEXP initialdesignSEXP, SEXP candidatelistSEXP, SEXP blockeddesignSEXP, SEXP conditionSEXP, SEXP momentsmatrixSEXP, SEXP initialRowsSEXP, SEXP blockedVarSEXP, SEXP aliasdesignSEXP, SEXP aliascandidatelistSEXP, SEXP minDoptSEXP, SEXP interactionsSEXP, SEXP disallowedSEXP, SEXP anydisallowedSEXP, SEXP toleranceSEXP, SEXP kexchangeSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< Eigen::MatrixXd >::type initialdesign(initialdesignSEXP);
-    Rcpp::traits::input_parameter< Eigen::MatrixXd >::type candidatelist(candidatelistSEXP);
+    Rcpp::traits::input_parameter< const Eigen::Map<Eigen::MatrixXd> >::type candidatelist(candidatelistSEXP);
     Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type blockeddesign(blockeddesignSEXP);
     Rcpp::traits::input_parameter< const std::string >::type condition(conditionSEXP);
     Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type momentsmatrix(momentsmatrixSEXP);
     Rcpp::traits::input_parameter< Eigen::VectorXi& >::type initialRows(initialRowsSEXP);
     Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type blockedVar(blockedVarSEXP);
     Rcpp::traits::input_parameter< Eigen::MatrixXd >::type aliasdesign(aliasdesignSEXP);
-    Rcpp::traits::input_parameter< Eigen::MatrixXd >::type aliascandidatelist(aliascandidatelistSEXP);
+    Rcpp::traits::input_parameter< const Eigen::Map<Eigen::MatrixXd> >::type aliascandidatelist(aliascandidatelistSEXP);
     Rcpp::traits::input_parameter< double >::type minDopt(minDoptSEXP);
     Rcpp::traits::input_parameter< List >::type interactions(interactionsSEXP);
     Rcpp::traits::input_parameter< const Eigen::MatrixXd >::type disallowed(disallowedSEXP);
@@ -190,20 +437,39 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// generateResponses
+Eigen::MatrixXd generateResponses(const Eigen::MatrixXd& X, const Eigen::VectorXd& b, List blocks, NumericVector blockvariances, std::string family, int firstsim, int count, int seed, int threads);
+RcppExport SEXP _skpr_generateResponses(SEXP XSEXP, SEXP bSEXP, SEXP blocksSEXP, SEXP blockvariancesSEXP, SEXP familySEXP, SEXP firstsimSEXP, SEXP countSEXP, SEXP seedSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const Eigen::VectorXd& >::type b(bSEXP);
+    Rcpp::traits::input_parameter< List >::type blocks(blocksSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type blockvariances(blockvariancesSEXP);
+    Rcpp::traits::input_parameter< std::string >::type family(familySEXP);
+    Rcpp::traits::input_parameter< int >::type firstsim(firstsimSEXP);
+    Rcpp::traits::input_parameter< int >::type count(countSEXP);
+    Rcpp::traits::input_parameter< int >::type seed(seedSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(generateResponses(X, b, blocks, blockvariances, family, firstsim, count, seed, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
 // genBlockedOptimalDesign
-List genBlockedOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixXd& candidatelist, const std::string condition, Eigen::MatrixXd V, const Eigen::MatrixXd& momentsmatrix, Eigen::VectorXi& initialRows, Eigen::MatrixXd aliasdesign, const Eigen::MatrixXd& aliascandidatelist, double minDopt, double tolerance, int augmentedrows, int kexchange);
+List genBlockedOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::Map<Eigen::MatrixXd> candidatelist, const std::string condition, Eigen::MatrixXd V, const Eigen::MatrixXd& momentsmatrix, Eigen::VectorXi& initialRows, Eigen::MatrixXd aliasdesign, const Eigen::Map<Eigen::MatrixXd> aliascandidatelist, double minDopt, double tolerance, int augmentedrows, int kexchange);
 RcppExport SEXP _skpr_genBlockedOptimalDesign(SEXP initialdesignSEXP, SEXP candidatelistSEXP, SEXP conditionSEXP, SEXP VSEXP, SEXP momentsmatrixSEXP, SEXP initialRowsSEXP, SEXP aliasdesignSEXP, SEXP aliascandidatelistSEXP, SEXP minDoptSEXP, SEXP toleranceSEXP, SEXP augmentedrowsSEXP, SEXP kexchangeSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< Eigen::MatrixXd >::type initialdesign(initialdesignSEXP);
-    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type candidatelist(candidatelistSEXP);
+    Rcpp::traits::input_parameter< const Eigen::Map<Eigen::MatrixXd> >::type candidatelist(candidatelistSEXP);
     Rcpp::traits::input_parameter< const std::string >::type condition(conditionSEXP);
     Rcpp::traits::input_parameter< Eigen::MatrixXd >::type V(VSEXP);
     Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type momentsmatrix(momentsmatrixSEXP);
     Rcpp::traits::input_parameter< Eigen::VectorXi& >::type initialRows(initialRowsSEXP);
     Rcpp::traits::input_parameter< Eigen::MatrixXd >::type aliasdesign(aliasdesignSEXP);
-    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type aliascandidatelist(aliascandidatelistSEXP);
+    Rcpp::traits::input_parameter< const Eigen::Map<Eigen::MatrixXd> >::type aliascandidatelist(aliascandidatelistSEXP);
     Rcpp::traits::input_parameter< double >::type minDopt(minDoptSEXP);
     Rcpp::traits::input_parameter< double >::type tolerance(toleranceSEXP);
     Rcpp::traits::input_parameter< int >::type augmentedrows(augmentedrowsSEXP);
@@ -212,8 +478,64 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// glmMonteCarlo
+List glmMonteCarlo(const Eigen::MatrixXd& X, const Eigen::MatrixXd& responses, const Eigen::MatrixXd& events, const std::string family, const Eigen::VectorXd& start, List hypotheses, int maxiterations, double tolerance, int threads);
+RcppExport SEXP _skpr_glmMonteCarlo(SEXP XSEXP, SEXP responsesSEXP, SEXP eventsSEXP, SEXP familySEXP, SEXP startSEXP, SEXP hypothesesSEXP, SEXP maxiterationsSEXP, SEXP toleranceSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type responses(responsesSEXP);
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type events(eventsSEXP);
+    Rcpp::traits::input_parameter< const std::string >::type family(familySEXP);
+    Rcpp::traits::input_parameter< const Eigen::VectorXd& >::type start(startSEXP);
+    Rcpp::traits::input_parameter< List >::type hypotheses(hypothesesSEXP);
+    Rcpp::traits::input_parameter< int >::type maxiterations(maxiterationsSEXP);
+    Rcpp::traits::input_parameter< double >::type tolerance(toleranceSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(glmMonteCarlo(X, responses, events, family, start, hypotheses, maxiterations, tolerance, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// powerGrid
+Eigen::MatrixXd powerGrid(const Eigen::MatrixXd& X, const Eigen::MatrixXd& V, List hypotheses, NumericVector degrees, const Eigen::MatrixXd& anticoefs, NumericVector alphas);
+RcppExport SEXP _skpr_powerGrid(SEXP XSEXP, SEXP VSEXP, SEXP hypothesesSEXP, SEXP degreesSEXP, SEXP anticoefsSEXP, SEXP alphasSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type V(VSEXP);
+    Rcpp::traits::input_parameter< List >::type hypotheses(hypothesesSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type degrees(degreesSEXP);
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type anticoefs(anticoefsSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type alphas(alphasSEXP);
+    rcpp_result_gen = Rcpp::wrap(powerGrid(X, V, hypotheses, degrees, anticoefs, alphas));
+    return rcpp_result_gen;
+END_RCPP
+}
+// remlMonteCarlo
+List remlMonteCarlo(const Eigen::MatrixXd& X, const Eigen::MatrixXd& responses, IntegerVector blocks, List hypotheses, int threads);
+RcppExport SEXP _skpr_remlMonteCarlo(SEXP XSEXP, SEXP responsesSEXP, SEXP blocksSEXP, SEXP hypothesesSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const Eigen::MatrixXd& >::type responses(responsesSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type blocks(blocksSEXP);
+    Rcpp::traits::input_parameter< List >::type hypotheses(hypothesesSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(remlMonteCarlo(X, responses, blocks, hypotheses, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
 
 static const R_CallMethodDef CallEntries[] = {
+    {"_skpr_screenCandidateSet", (DL_FUNC) &_skpr_screenCandidateSet, 3},
+    {"_skpr_approximateOptimalityBound", (DL_FUNC) &_skpr_approximateOptimalityBound, 6},
+    {"_skpr_candidateModelMatrices", (DL_FUNC) &_skpr_candidateModelMatrices, 2},
+    {"_skpr_createDesignSession", (DL_FUNC) &_skpr_createDesignSession, 8},
+    {"_skpr_runDesignSession", (DL_FUNC) &_skpr_runDesignSession, 3},
+    {"_skpr_waldEffectPvalues", (DL_FUNC) &_skpr_waldEffectPvalues, 3},
     {"_skpr_DOptimality", (DL_FUNC) &_skpr_DOptimality, 1},
     {"_skpr_DOptimalityLog", (DL_FUNC) &_skpr_DOptimalityLog, 1},
     {"_skpr_DOptimalityBlocked", (DL_FUNC) &_skpr_DOptimalityBlocked, 2},
@@ -226,9 +548,24 @@ static const R_CallMethodDef CallEntries[] = {
     {"_skpr_covarianceMatrixPseudo", (DL_FUNC) &_skpr_covarianceMatrixPseudo, 1},
     {"_skpr_getPseudoInverse", (DL_FUNC) &_skpr_getPseudoInverse, 1},
     {"_skpr_GEfficiency", (DL_FUNC) &_skpr_GEfficiency, 2},
+    {"_skpr_designCriteria", (DL_FUNC) &_skpr_designCriteria, 4},
+    {"_skpr_designSessionCriteria", (DL_FUNC) &_skpr_designSessionCriteria, 3},
+    {"_skpr_exchangeSearch", (DL_FUNC) &_skpr_exchangeSearch, 4},
+    {"_skpr_dExchangePass", (DL_FUNC) &_skpr_dExchangePass, 2},
+    {"_skpr_predictionVariances", (DL_FUNC) &_skpr_predictionVariances, 4},
+    {"_skpr_fdsPredictionVariances", (DL_FUNC) &_skpr_fdsPredictionVariances, 7},
+    {"_skpr_gEfficiencyMaximum", (DL_FUNC) &_skpr_gEfficiencyMaximum, 8},
+    {"_skpr_continuousModelRows", (DL_FUNC) &_skpr_continuousModelRows, 5},
+    {"_skpr_gaussianMonteCarlo", (DL_FUNC) &_skpr_gaussianMonteCarlo, 3},
+    {"_skpr_genFactorialOptimalDesign", (DL_FUNC) &_skpr_genFactorialOptimalDesign, 8},
+    {"_skpr_factorialCandidateRows", (DL_FUNC) &_skpr_factorialCandidateRows, 4},
     {"_skpr_genOptimalDesign", (DL_FUNC) &_skpr_genOptimalDesign, 11},
     {"_skpr_genSplitPlotOptimalDesign", (DL_FUNC) &_skpr_genSplitPlotOptimalDesign, 15},
+    {"_skpr_generateResponses", (DL_FUNC) &_skpr_generateResponses, 9},
     {"_skpr_genBlockedOptimalDesign", (DL_FUNC) &_skpr_genBlockedOptimalDesign, 12},
+    {"_skpr_glmMonteCarlo", (DL_FUNC) &_skpr_glmMonteCarlo, 9},
+    {"_skpr_powerGrid", (DL_FUNC) &_skpr_powerGrid, 6},
+    {"_skpr_remlMonteCarlo", (DL_FUNC) &_skpr_remlMonteCarlo, 5},
     {NULL, NULL, 0}
 };
 
@@ -0,0 +1,142 @@
+#include <RcppEigen.h>
+#include <cmath>
+#include <vector>
+
+using namespace Rcpp;
+
+//`@title screenCandidateSet
+//`@param candidatelist The full candidate set in model matrix form.
+//`@param tolerance Stop once the largest candidate prediction variance is within this fraction of the number of parameters.
+//`@param maxiterations Maximum number of multiplicative algorithm iterations.
+//`@return Indices (starting at 1) of the candidates that can be in the support of the approximate D-optimal design.
+// [[Rcpp::export]]
+Eigen::VectorXi screenCandidateSet(const Eigen::MatrixXd& candidatelist, double tolerance, int maxiterations) {
+  int totalPoints = candidatelist.rows();
+  double numbercols = candidatelist.cols();
+  //Candidates still in play and their design weights; start from the uniform design.
+  std::vector<int> active(totalPoints);
+  for(int i = 0; i < totalPoints; i++) {
+    active[i] = i;
+  }
+  Eigen::VectorXd weights = Eigen::VectorXd::Constant(totalPoints, 1.0/totalPoints);
+  Eigen::VectorXd variances(totalPoints);
+  double bound = 0;
+  for(int iteration = 0; iteration <= maxiterations; iteration++) {
+    Rcpp::checkUserInterrupt();
+    int nactive = active.size();
+    Eigen::MatrixXd X(nactive, candidatelist.cols());
+    Eigen::VectorXd activeweights(nactive);
+    for(int i = 0; i < nactive; i++) {
+      X.row(i) = candidatelist.row(active[i]);
+      activeweights(i) = weights(active[i]);
+    }
+    Eigen::LLT<Eigen::MatrixXd> llt(X.transpose()*activeweights.asDiagonal()*X);
+    if(llt.info() != Eigen::Success) {
+      throw std::runtime_error("Candidate set does not support the model: cannot screen candidates");
+    }
+    //d(x) = x'M(w)^-1 x for every active candidate
+    Eigen::MatrixXd Linvx = llt.matrixL().solve(X.transpose());
+    double maxvariance = 0;
+    for(int i = 0; i < nactive; i++) {
+      variances(active[i]) = Linvx.col(i).squaredNorm();
+      maxvariance = std::max(maxvariance, variances(active[i]));
+    }
+    //Harman-Pronzato: a candidate with d(x) below this cannot support any D-optimal approximate design.
+    double epsilon = std::max(maxvariance - numbercols, 0.0);
+    bound = numbercols*(1 + epsilon/2 - std::sqrt(epsilon*(4 + epsilon - 4/numbercols))/2);
+    if(epsilon <= tolerance*numbercols || iteration == maxiterations) {
+      break;
+    }
+    std::vector<int> remaining;
+    remaining.reserve(nactive);
+    double totalweight = 0;
+    for(int i = 0; i < nactive; i++) {
+      int j = active[i];
+      if(variances(j) >= bound) {
+        weights(j) *= variances(j)/numbercols;
+        totalweight += weights(j);
+        remaining.push_back(j);
+      }
+    }
+    for(size_t i = 0; i < remaining.size(); i++) {
+      weights(remaining[i]) /= totalweight;
+    }
+    active.swap(remaining);
+  }
+  std::vector<int> keep;
+  for(size_t i = 0; i < active.size(); i++) {
+    if(variances(active[i]) >= bound) {
+      keep.push_back(active[i] + 1); //R indexes start at 1
+    }
+  }
+  Eigen::VectorXi keepindices(keep.size());
+  for(size_t i = 0; i < keep.size(); i++) {
+    keepindices(i) = keep[i];
+  }
+  return(keepindices);
+}
+
+//`@title approximateOptimalityBound
+//`@param candidatelist The full candidate set in model matrix form.
+//`@param condition Optimality criterion ("D", "A", or "I").
+//`@param momentsmatrix The moment matrix.
+//`@param trials The number of runs in the exact design.
+//`@param tolerance Stop once the equivalence theorem shows the approximate design is within this fraction of optimal.
+//`@param maxiterations Maximum number of multiplicative algorithm iterations.
+//`@return Bound on the criterion value returned by genOptimalDesign for any exact design with `trials` runs: an upper
+//`bound for D, a lower bound for A and I.
+// [[Rcpp::export]]
+double approximateOptimalityBound(const Eigen::MatrixXd& candidatelist, const std::string condition,
+                                  const Eigen::MatrixXd& momentsmatrix, int trials,
+                                  double tolerance, int maxiterations) {
+  int totalPoints = candidatelist.rows();
+  double numbercols = candidatelist.cols();
+  if(condition != "D" && condition != "A" && condition != "I") {
+    throw std::runtime_error("Approximate design bounds are only available for D, A, and I-optimality");
+  }
+  Eigen::MatrixXd W;
+  if(condition == "I") {
+    W = momentsmatrix;
+  } else {
+    W = Eigen::MatrixXd::Identity(candidatelist.cols(), candidatelist.cols());
+  }
+  Eigen::VectorXd weights = Eigen::VectorXd::Constant(totalPoints, 1.0/totalPoints);
+  Eigen::VectorXd variances(totalPoints);
+  //Every iterate gives a valid bound through the equivalence theorem, so keep the tightest one seen.
+  double bound = condition == "D" ? INFINITY : 0;
+  for(int iteration = 0; iteration < maxiterations; iteration++) {
+    Rcpp::checkUserInterrupt();
+    Eigen::LLT<Eigen::MatrixXd> llt(candidatelist.transpose()*weights.asDiagonal()*candidatelist);
+    if(llt.info() != Eigen::Success) {
+      throw std::runtime_error("Candidate set does not support the model: cannot calculate approximate design bound");
+    }
+    if(condition == "D") {
+      //det(M*)^(1/p) <= det(M(w))^(1/p) * max d(x)/p, with d(x) = x'M(w)^-1 x
+      variances = llt.matrixL().solve(candidatelist.transpose()).colwise().squaredNorm().transpose();
+      double maxvariance = variances.maxCoeff();
+      double logdet = 2*llt.matrixLLT().diagonal().array().log().sum();
+      bound = std::min(bound, exp(logdet/numbercols)*maxvariance/numbercols);
+      if(maxvariance/numbercols - 1 <= tolerance) {
+        break;
+      }
+      weights = weights.cwiseProduct(variances)/numbercols;
+    } else {
+      //tr(M*^-1 W) >= tr(M(w)^-1 W)^2 / max x'M(w)^-1 W M(w)^-1 x
+      Eigen::MatrixXd XMinv = llt.solve(candidatelist.transpose()).transpose();
+      variances = (XMinv*W).cwiseProduct(XMinv).rowwise().sum();
+      double maxvariance = variances.maxCoeff();
+      double tracevalue = llt.solve(W).trace();
+      bound = std::max(bound, tracevalue*tracevalue/maxvariance);
+      if(maxvariance/tracevalue - 1 <= tolerance) {
+        break;
+      }
+      weights = weights.cwiseProduct(variances.cwiseMax(0).cwiseSqrt());
+      weights /= weights.sum();
+    }
+  }
+  //The exact design criteria are per-run for D and for the total information X'X = trials*M for A and I.
+  if(condition == "D") {
+    return(bound);
+  }
+  return(bound/trials);
+}
@@ -0,0 +1,133 @@
+#include <RcppEigen.h>
+// [[Rcpp::depends(RcppEigen)]]
+#include <vector>
+
+using namespace Rcpp;
+
+//A factor coding gathered over the candidate set: one row per candidate, one column per coding column.
+struct GatheredCoding {
+  int factor;
+  Eigen::MatrixXd coding;
+  Eigen::MatrixXd values;
+};
+
+//The model matrix columns of one term over the candidate set.
+struct ExpandedTerm {
+  std::vector<int> factors;
+  std::vector<Eigen::MatrixXd> codings;
+  Eigen::MatrixXd values;
+};
+
+static const Eigen::MatrixXd& gatherCoding(const Eigen::MatrixXi& levelindices, int factor, const Eigen::MatrixXd& coding,
+                                           std::vector<GatheredCoding>& gathered) {
+  for(size_t i = 0; i < gathered.size(); i++) {
+    if(gathered[i].factor == factor && gathered[i].coding.rows() == coding.rows() &&
+       gathered[i].coding.cols() == coding.cols() && gathered[i].coding == coding) {
+      return(gathered[i].values);
+    }
+  }
+  GatheredCoding newcoding;
+  newcoding.factor = factor;
+  newcoding.coding = coding;
+  newcoding.values.resize(levelindices.rows(), coding.cols());
+  for(int j = 0; j < coding.cols(); j++) {
+    for(int i = 0; i < levelindices.rows(); i++) {
+      newcoding.values(i, j) = coding(levelindices(i, factor), j);
+    }
+  }
+  gathered.push_back(newcoding);
+  return(gathered.back().values);
+}
+
+static bool sameTerm(const ExpandedTerm& term, const std::vector<int>& factors, const std::vector<Eigen::MatrixXd>& codings) {
+  if(term.factors != factors) {
+    return(false);
+  }
+  for(size_t k = 0; k < codings.size(); k++) {
+    if(term.codings[k].rows() != codings[k].rows() || term.codings[k].cols() != codings[k].cols() ||
+       term.codings[k] != codings[k]) {
+      return(false);
+    }
+  }
+  return(true);
+}
+
+//`@title candidateModelMatrices
+//`@param levelindices Integer matrix of the 0-based level index of each factor (columns) for each candidate (rows).
+//`@param models List of models, each a list with `terms` (as in genFactorialOptimalDesign) and `intercept`.
+//`@return List of the candidate set model matrices, one per model.
+// [[Rcpp::export]]
+List candidateModelMatrices(const Eigen::MatrixXi& levelindices, List models) {
+  int numberrows = levelindices.rows();
+  //Factor codings and expanded terms are shared across models: the alias model repeats the main model's
+  //terms, and interactions reuse the gathered codings of their main effects.
+  std::vector<GatheredCoding> gathered;
+  std::vector<ExpandedTerm> expanded;
+  List modelmatrices(models.size());
+  for(int m = 0; m < models.size(); m++) {
+    List model = models[m];
+    List terms = model["terms"];
+    bool intercept = as<bool>(model["intercept"]);
+    std::vector<int> termindex;
+    int numbercols = intercept ? 1 : 0;
+    for(int t = 0; t < terms.size(); t++) {
+      Rcpp::checkUserInterrupt();
+      List term = terms[t];
+      IntegerVector termfactors = term["factors"];
+      List termcodings = term["codings"];
+      std::vector<int> factors;
+      std::vector<Eigen::MatrixXd> codings;
+      for(int k = 0; k < termfactors.size(); k++) {
+        if(termfactors[k] < 0 || termfactors[k] >= levelindices.cols()) {
+          throw std::runtime_error("Model term refers to a factor that is not in the candidate set");
+        }
+        factors.push_back(termfactors[k]);
+        codings.push_back(as<Eigen::MatrixXd>(termcodings[k]));
+      }
+      int found = -1;
+      for(size_t i = 0; i < expanded.size() && found < 0; i++) {
+        if(sameTerm(expanded[i], factors, codings)) {
+          found = i;
+        }
+      }
+      if(found < 0) {
+        //Row-wise Kronecker product of the gathered codings, with the first factor's columns varying fastest
+        ExpandedTerm newterm;
+        newterm.factors = factors;
+        newterm.codings = codings;
+        if(factors.empty()) {
+          newterm.values = Eigen::MatrixXd::Ones(numberrows, 1);
+        } else {
+          newterm.values = gatherCoding(levelindices, factors[0], codings[0], gathered);
+        }
+        for(size_t k = 1; k < factors.size(); k++) {
+          const Eigen::MatrixXd& values = gatherCoding(levelindices, factors[k], codings[k], gathered);
+          int termsize = newterm.values.cols();
+          Eigen::MatrixXd product(numberrows, termsize*values.cols());
+          for(int j = 0; j < values.cols(); j++) {
+            for(int e = 0; e < termsize; e++) {
+              product.col(e + termsize*j) = newterm.values.col(e).cwiseProduct(values.col(j));
+            }
+          }
+          newterm.values.swap(product);
+        }
+        expanded.push_back(newterm);
+        found = expanded.size() - 1;
+      }
+      termindex.push_back(found);
+      numbercols += expanded[found].values.cols();
+    }
+    Eigen::MatrixXd modelmatrix(numberrows, numbercols);
+    int offset = 0;
+    if(intercept) {
+      modelmatrix.col(offset++).setOnes();
+    }
+    for(size_t t = 0; t < termindex.size(); t++) {
+      const Eigen::MatrixXd& values = expanded[termindex[t]].values;
+      modelmatrix.middleCols(offset, values.cols()) = values;
+      offset += values.cols();
+    }
+    modelmatrices[m] = modelmatrix;
+  }
+  return(modelmatrices);
+}
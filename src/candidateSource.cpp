@@ -0,0 +1,150 @@
+#include <RcppEigen.h>
+// [[Rcpp::depends(RcppEigen)]]
+#include "candidateSource.h"
+
+using namespace Rcpp;
+
+CandidateSource::CandidateSource(const std::vector<int>& levelcounts,
+                                 const std::vector<std::vector<int> >& termfactors,
+                                 const std::vector<std::vector<Eigen::MatrixXd> >& termcodings,
+                                 bool intercept, const Eigen::MatrixXi& disallowed) :
+  levelcounts(levelcounts), termfactors(termfactors), termcodings(termcodings),
+  intercept(intercept), disallowed(disallowed) {
+  if(termfactors.size() != termcodings.size()) {
+    throw std::runtime_error("Each model term needs one coding per factor");
+  }
+  if(disallowed.rows() > 0 && disallowed.cols() != (int)levelcounts.size()) {
+    throw std::runtime_error("Disallowed combinations need one column per factor");
+  }
+  totalPoints = 1;
+  for(size_t i = 0; i < levelcounts.size(); i++) {
+    if(levelcounts[i] < 1) {
+      throw std::runtime_error("Every factor needs at least one level");
+    }
+    totalPoints *= levelcounts[i];
+  }
+  numbercols = intercept ? 1 : 0;
+  for(size_t t = 0; t < termfactors.size(); t++) {
+    if(termfactors[t].size() != termcodings[t].size()) {
+      throw std::runtime_error("Each model term needs one coding per factor");
+    }
+    int ncols = 1;
+    for(size_t k = 0; k < termfactors[t].size(); k++) {
+      int factor = termfactors[t][k];
+      if(factor < 0 || factor >= (int)levelcounts.size()) {
+        throw std::runtime_error("Model term refers to a factor that is not in the candidate set");
+      }
+      if(termcodings[t][k].rows() != levelcounts[factor]) {
+        throw std::runtime_error("Factor coding needs one row per factor level");
+      }
+      ncols *= termcodings[t][k].cols();
+    }
+    termcols.push_back(ncols);
+    numbercols += ncols;
+  }
+}
+
+long long CandidateSource::size() const {
+  return(totalPoints);
+}
+
+int CandidateSource::cols() const {
+  return(numbercols);
+}
+
+void CandidateSource::levels(long long index, std::vector<int>& levelindices) const {
+  levelindices.resize(levelcounts.size());
+  for(size_t i = 0; i < levelcounts.size(); i++) {
+    levelindices[i] = index % levelcounts[i];
+    index /= levelcounts[i];
+  }
+}
+
+long long CandidateSource::index(const std::vector<int>& levelindices) const {
+  long long index = 0;
+  for(int i = levelcounts.size() - 1; i >= 0; i--) {
+    index = index*levelcounts[i] + levelindices[i];
+  }
+  return(index);
+}
+
+bool CandidateSource::allowed(const std::vector<int>& levelindices) const {
+  for(int i = 0; i < disallowed.rows(); i++) {
+    bool matches = true;
+    for(int j = 0; j < disallowed.cols() && matches; j++) {
+      matches = disallowed(i, j) < 0 || disallowed(i, j) == levelindices[j];
+    }
+    if(matches) {
+      return(false);
+    }
+  }
+  return(true);
+}
+
+void CandidateSource::row(const std::vector<int>& levelindices, double* out) const {
+  int offset = 0;
+  if(intercept) {
+    out[offset++] = 1;
+  }
+  //Expand each term in place as a Kronecker product, with the first factor's columns varying fastest
+  //(the order used by model.matrix).
+  for(size_t t = 0; t < termfactors.size(); t++) {
+    double* term = out + offset;
+    int termsize = 1;
+    term[0] = 1;
+    for(size_t k = 0; k < termfactors[t].size(); k++) {
+      const Eigen::MatrixXd& coding = termcodings[t][k];
+      int level = levelindices[termfactors[t][k]];
+      for(int j = coding.cols() - 1; j >= 0; j--) {
+        double value = coding(level, j);
+        for(int e = 0; e < termsize; e++) {
+          term[e + termsize*j] = term[e]*value;
+        }
+      }
+      termsize *= coding.cols();
+    }
+    offset += termcols[t];
+  }
+}
+
+void CandidateSource::row(long long index, Eigen::VectorXd& out) const {
+  std::vector<int> levelindices;
+  levels(index, levelindices);
+  out.resize(numbercols);
+  row(levelindices, out.data());
+}
+
+long long CandidateSource::tile(long long start, int tilesize, Eigen::MatrixXd& tile_trans,
+                                std::vector<long long>& indices) const {
+  //Fills the columns of tile_trans with up to tilesize allowed candidates, starting at candidate start.
+  //Returns the candidate to start the next tile from.
+  tile_trans.resize(numbercols, tilesize);
+  indices.clear();
+  std::vector<int> levelindices;
+  long long index = start;
+  while(index < totalPoints && (int)indices.size() < tilesize) {
+    levels(index, levelindices);
+    if(allowed(levelindices)) {
+      row(levelindices, tile_trans.col(indices.size()).data());
+      indices.push_back(index);
+    }
+    index++;
+  }
+  return(index);
+}
+
+CandidateSource candidateSourceFromList(const Rcpp::IntegerVector& levelcounts, const Rcpp::List& terms,
+                                        bool intercept, const Eigen::MatrixXi& disallowed) {
+  std::vector<std::vector<int> > termfactors(terms.size());
+  std::vector<std::vector<Eigen::MatrixXd> > termcodings(terms.size());
+  for(int t = 0; t < terms.size(); t++) {
+    List term = terms[t];
+    IntegerVector factors = term["factors"];
+    List codings = term["codings"];
+    for(int k = 0; k < factors.size(); k++) {
+      termfactors[t].push_back(factors[k]);
+      termcodings[t].push_back(as<Eigen::MatrixXd>(codings[k]));
+    }
+  }
+  return(CandidateSource(as<std::vector<int> >(levelcounts), termfactors, termcodings, intercept, disallowed));
+}
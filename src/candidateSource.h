@@ -0,0 +1,49 @@
+#ifndef CANDIDATESOURCE_H
+#define CANDIDATESOURCE_H
+
+#include <RcppEigen.h>
+#include <vector>
+
+//Describes the full factorial over a set of factor levels without materializing it. Candidates are
+//numbered in expand.grid order (first factor varying fastest), and the model matrix row of any candidate
+//is built from its level indices: each model term is the product of per-factor codings (contrast
+//columns for categorical factors, transformed level values for numeric factors).
+class CandidateSource {
+public:
+  CandidateSource(const std::vector<int>& levelcounts,
+                  const std::vector<std::vector<int> >& termfactors,
+                  const std::vector<std::vector<Eigen::MatrixXd> >& termcodings,
+                  bool intercept, const Eigen::MatrixXi& disallowed);
+
+  long long size() const;
+
+  int cols() const;
+
+  void levels(long long index, std::vector<int>& levelindices) const;
+
+  long long index(const std::vector<int>& levelindices) const;
+
+  bool allowed(const std::vector<int>& levelindices) const;
+
+  void row(const std::vector<int>& levelindices, double* out) const;
+
+  void row(long long index, Eigen::VectorXd& out) const;
+
+  long long tile(long long start, int tilesize, Eigen::MatrixXd& tile_trans, std::vector<long long>& indices) const;
+
+private:
+  std::vector<int> levelcounts;
+  std::vector<std::vector<int> > termfactors;
+  std::vector<std::vector<Eigen::MatrixXd> > termcodings;
+  std::vector<int> termcols;
+  bool intercept;
+  //One row per disallowed combination of level indices, with -1 matching any level.
+  Eigen::MatrixXi disallowed;
+  long long totalPoints;
+  int numbercols;
+};
+
+CandidateSource candidateSourceFromList(const Rcpp::IntegerVector& levelcounts, const Rcpp::List& terms,
+                                        bool intercept, const Eigen::MatrixXi& disallowed);
+
+#endif
@@ -0,0 +1,88 @@
+#include <RcppEigen.h>
+// [[Rcpp::depends(RcppEigen)]]
+
+#include "optimalityfunctions.h"
+#include "designSession.h"
+
+using namespace Rcpp;
+
+void prepareCandidateSearch(const Eigen::Ref<const Eigen::MatrixXd>& candidatelist, const std::string& condition,
+                            bool blocked, const Eigen::MatrixXd& V, CandidateSearchCache& cache) {
+  //Check for singularity from a column perfectly correlating with the intercept.
+  for(int j = 1; j < candidatelist.cols(); j++) {
+    if(candidatelist.col(0).cwiseEqual(candidatelist.col(j)).all()) {
+      throw std::runtime_error("Singular model matrix from factor aliased into intercept, revise model");
+    }
+  }
+  cache.candidatelist_trans = candidatelist.transpose();
+  if(blocked) {
+    cache.vInv = V.colPivHouseholderQr().inverse();
+  }
+}
+
+//`@title createDesignSession
+//`@param candidatelist The full candidate set in model matrix form.
+//`@param aliascandidatelist The full candidate set with the aliasing model in model matrix form.
+//`@param condition Optimality criterion.
+//`@param momentsmatrix The moment matrix.
+//`@param V The variance-covariance matrix of the runs for a blocked design, or NULL.
+//`@param minDopt Minimum D-optimality during an Alias-optimal search.
+//`@param tolerance Stopping tolerance for fractional increase in optimality criteria.
+//`@param kexchange Number of rows exchanged per pass of the search.
+//`@return External pointer to the design session.
+// [[Rcpp::export]]
+SEXP createDesignSession(NumericMatrix candidatelist, NumericMatrix aliascandidatelist, const std::string condition,
+                         const Eigen::MatrixXd& momentsmatrix, Nullable<NumericMatrix> V,
+                         double minDopt, double tolerance, int kexchange) {
+  DesignSession* session = new DesignSession();
+  XPtr<DesignSession> sessionptr(session, true);
+  session->candidates = candidatelist;
+  session->aliascandidates = aliascandidatelist;
+  session->condition = condition;
+  session->momentsmatrix = momentsmatrix;
+  session->blocked = V.isNotNull();
+  if(session->blocked) {
+    session->V = as<Eigen::MatrixXd>(V.get());
+  }
+  session->minDopt = minDopt;
+  session->tolerance = tolerance;
+  session->kexchange = kexchange;
+  Eigen::Map<const Eigen::MatrixXd> candidates(candidatelist.begin(), candidatelist.nrow(), candidatelist.ncol());
+  prepareCandidateSearch(candidates, condition, session->blocked, session->V, session->cache);
+  return(sessionptr);
+}
+
+//`@title runDesignSession
+//`@param session External pointer returned by createDesignSession.
+//`@param initialRows The rows from the candidate set chosen for the initial design.
+//`@param augmentdesign The fixed rows of an augmented design in model matrix form, which replace the first
+//`rows of the initial design (zero rows if not augmenting).
+//`@return List of design information, as returned by genOptimalDesign.
+// [[Rcpp::export]]
+List runDesignSession(SEXP session, Eigen::VectorXi initialRows, const Eigen::MatrixXd& augmentdesign) {
+  XPtr<DesignSession> sessionptr(session);
+  const DesignSession& s = *sessionptr;
+  Eigen::Map<const Eigen::MatrixXd> candidatelist(s.candidates.begin(), s.candidates.nrow(), s.candidates.ncol());
+  Eigen::Map<const Eigen::MatrixXd> aliascandidatelist(s.aliascandidates.begin(), s.aliascandidates.nrow(),
+                                                       s.aliascandidates.ncol());
+  int nTrials = initialRows.size();
+  int augmentedrows = augmentdesign.rows();
+  Eigen::MatrixXd initialdesign(nTrials, candidatelist.cols());
+  Eigen::MatrixXd aliasdesign(nTrials, aliascandidatelist.cols());
+  for(int i = 0; i < nTrials; i++) {
+    if(initialRows(i) < 1 || initialRows(i) > candidatelist.rows()) {
+      throw std::runtime_error("Initial design row is not in the candidate set");
+    }
+    initialdesign.row(i) = candidatelist.row(initialRows(i) - 1);
+    aliasdesign.row(i) = aliascandidatelist.row(initialRows(i) - 1);
+  }
+  if(augmentedrows > 0) {
+    initialdesign.topRows(augmentedrows) = augmentdesign;
+  }
+  if(s.blocked) {
+    return(searchBlockedOptimalDesign(initialdesign, candidatelist, s.cache, s.condition, s.V, s.momentsmatrix, initialRows,
+                                      aliasdesign, aliascandidatelist, s.minDopt, s.tolerance, augmentedrows, s.kexchange));
+  }
+  return(searchOptimalDesign(initialdesign, candidatelist, s.cache, s.condition, s.momentsmatrix, initialRows.cast<double>(),
+                             aliasdesign, aliascandidatelist, s.minDopt, s.tolerance, augmentedrows, s.kexchange));
+}
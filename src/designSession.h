@@ -0,0 +1,45 @@
+#ifndef DESIGNSESSION_H
+#define DESIGNSESSION_H
+
+#include <RcppEigen.h>
+#include <string>
+
+//Everything about a candidate set that doesn't change from one design search to the next. A single call to
+//genOptimalDesign or genBlockedOptimalDesign builds this on the fly; a design session builds it once and reuses
+//it for every search in a gen_design() call.
+struct CandidateSearchCache {
+  Eigen::MatrixXd candidatelist_trans;
+  Eigen::MatrixXd vInv;
+};
+
+void prepareCandidateSearch(const Eigen::Ref<const Eigen::MatrixXd>& candidatelist, const std::string& condition,
+                            bool blocked, const Eigen::MatrixXd& V, CandidateSearchCache& cache);
+
+Rcpp::List searchOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::Ref<const Eigen::MatrixXd>& candidatelist,
+                               const CandidateSearchCache& cache, const std::string& condition,
+                               const Eigen::MatrixXd& momentsmatrix, Eigen::VectorXd initialRows,
+                               Eigen::MatrixXd aliasdesign, const Eigen::Ref<const Eigen::MatrixXd>& aliascandidatelist,
+                               double minDopt, double tolerance, int augmentedrows, int kexchange);
+
+Rcpp::List searchBlockedOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::Ref<const Eigen::MatrixXd>& candidatelist,
+                                      const CandidateSearchCache& cache, const std::string& condition,
+                                      const Eigen::MatrixXd& V, const Eigen::MatrixXd& momentsmatrix,
+                                      Eigen::VectorXi& initialRows, Eigen::MatrixXd aliasdesign,
+                                      const Eigen::Ref<const Eigen::MatrixXd>& aliascandidatelist,
+                                      double minDopt, double tolerance, int augmentedrows, int kexchange);
+
+//The invariant inputs and precomputation of one gen_design() call, held by R as an external pointer.
+struct DesignSession {
+  Rcpp::NumericMatrix candidates;
+  Rcpp::NumericMatrix aliascandidates;
+  std::string condition;
+  Eigen::MatrixXd momentsmatrix;
+  bool blocked;
+  Eigen::MatrixXd V;
+  double minDopt;
+  double tolerance;
+  int kexchange;
+  CandidateSearchCache cache;
+};
+
+#endif
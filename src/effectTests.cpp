@@ -0,0 +1,57 @@
+#include <RcppEigen.h>
+// [[Rcpp::depends(RcppEigen)]]
+
+#include "effectTests.h"
+
+using namespace Rcpp;
+
+std::vector<Eigen::MatrixXd> hypothesisMatrices(const List& hypotheses, int parameters) {
+  std::vector<Eigen::MatrixXd> matrices;
+  for(int e = 0; e < hypotheses.size(); e++) {
+    Eigen::MatrixXd L = as<Eigen::MatrixXd>(hypotheses[e]);
+    if(L.cols() != parameters) {
+      throw std::runtime_error("Hypothesis matrix needs one column per model parameter");
+    }
+    matrices.push_back(L);
+  }
+  return(matrices);
+}
+
+double waldStatistic(const Eigen::MatrixXd& L, const Eigen::VectorXd& coefficients, const Eigen::MatrixXd& covariance) {
+  Eigen::VectorXd contrast = L * coefficients;
+  return(contrast.dot((L * covariance * L.transpose()).ldlt().solve(contrast)));
+}
+
+Eigen::MatrixXd sharedCovarianceStatistics(const std::vector<Eigen::MatrixXd>& hypotheses,
+                                           const Eigen::MatrixXd& covariance, const Eigen::MatrixXd& estimates) {
+  Eigen::MatrixXd statistics(hypotheses.size(), estimates.cols());
+  for(size_t e = 0; e < hypotheses.size(); e++) {
+    const Eigen::MatrixXd& L = hypotheses[e];
+    Eigen::MatrixXd whitened = (L * covariance * L.transpose()).llt().matrixL().solve(L);
+    statistics.row(e) = (whitened * estimates).colwise().squaredNorm();
+  }
+  return(statistics);
+}
+
+//`@title waldEffectPvalues
+//`@param estimates The estimated coefficients, one row per simulation.
+//`@param covariances List of the covariance matrix of the estimates of each simulation.
+//`@param hypotheses List of the hypothesis matrix of each effect.
+//`@return The Type-III Wald chi-squared p-value of each effect (columns) in each simulation (rows).
+// [[Rcpp::export]]
+Eigen::MatrixXd waldEffectPvalues(const Eigen::MatrixXd& estimates, List covariances, List hypotheses) {
+  int nsim = estimates.rows();
+  if(covariances.size() != nsim) {
+    throw std::runtime_error("Need one covariance matrix per simulation");
+  }
+  std::vector<Eigen::MatrixXd> L = hypothesisMatrices(hypotheses, estimates.cols());
+  Eigen::MatrixXd pvals(nsim, L.size());
+  for(int i = 0; i < nsim; i++) {
+    Eigen::MatrixXd covariance = as<Eigen::MatrixXd>(covariances[i]);
+    Eigen::VectorXd coefficients = estimates.row(i).transpose();
+    for(size_t e = 0; e < L.size(); e++) {
+      pvals(i, e) = R::pchisq(waldStatistic(L[e], coefficients, covariance), L[e].rows(), 0, 0);
+    }
+  }
+  return(pvals);
+}
@@ -0,0 +1,21 @@
+#ifndef EFFECTTESTS_H
+#define EFFECTTESTS_H
+
+#include <RcppEigen.h>
+#include <vector>
+
+//Effect tests for Monte Carlo power, from the hypothesis matrix L of each effect (built once per design by
+//effect_hypothesis_matrices() in R) and each simulation's coefficients and their covariance.
+
+std::vector<Eigen::MatrixXd> hypothesisMatrices(const Rcpp::List& hypotheses, int parameters);
+
+//The Wald statistic (Lb)'(LCL')^-1(Lb) of one effect.
+double waldStatistic(const Eigen::MatrixXd& L, const Eigen::VectorXd& coefficients, const Eigen::MatrixXd& covariance);
+
+//Wald statistics of every effect (rows) and simulation (columns) when the simulations share the covariance C
+//of the estimates up to a scale factor: each L is whitened by LCL' once, so every simulation then costs one
+//matrix product. The statistics are for the unscaled C, so divide by each simulation's scale.
+Eigen::MatrixXd sharedCovarianceStatistics(const std::vector<Eigen::MatrixXd>& hypotheses,
+                                           const Eigen::MatrixXd& covariance, const Eigen::MatrixXd& estimates);
+
+#endif
@@ -1,6 +1,8 @@
 // [[Rcpp::depends(RcppEigen)]]
 
 #include <RcppEigen.h>
+#include "optimalityfunctions.h"
+#include "designSession.h"
 using namespace Rcpp;
 
 // [[Rcpp::export]]
@@ -52,7 +54,6 @@ double IOptimality(const Eigen::MatrixXd& currentDesign, const Eigen::MatrixXd&
   return(XtX.trace());
 }
 
-
 // [[Rcpp::export]]
 double calcAliasTrace(const Eigen::MatrixXd& currentDesign, const Eigen::MatrixXd& aliasMatrix) {
   Eigen::MatrixXd XtX = currentDesign.transpose() * currentDesign;
@@ -73,9 +74,192 @@ Eigen::MatrixXd getPseudoInverse(const Eigen::MatrixXd& currentDesign) {
 
 // [[Rcpp::export]]
 double GEfficiency(const Eigen::MatrixXd& currentDesign, const Eigen::MatrixXd& candset) {
-  Eigen::MatrixXd V = (currentDesign.transpose()*currentDesign).partialPivLu().inverse();
-  Eigen::MatrixXd results = candset*V*candset.transpose();
-  return(100*((double)currentDesign.cols()/(double)currentDesign.rows())*1/results.diagonal().maxCoeff());
+  //Only the diagonal of candset*(X'X)^-1*candset' is needed: take it in chunks of candidates as the squared
+  //column norms of L^-1*candset', instead of forming the full n x n matrix.
+  Eigen::LLT<Eigen::MatrixXd> llt(currentDesign.transpose()*currentDesign);
+  int chunksize = 1024;
+  double maxvariance = 0;
+  Eigen::MatrixXd chunk;
+  for(int start = 0; start < candset.rows(); start += chunksize) {
+    chunk = candset.middleRows(start, std::min(chunksize, (int)candset.rows() - start)).transpose();
+    llt.matrixL().solveInPlace(chunk);
+    maxvariance = std::max(maxvariance, chunk.colwise().squaredNorm().maxCoeff());
+  }
+  return(100*((double)currentDesign.cols()/(double)currentDesign.rows())*1/maxvariance);
+}
+
+
+
+//Every criterion of each design in designs from one factorization of its information matrix: X'X, or X'V^-1X
+//when vInv is given. I is only computed with a moments matrix and the alias trace only with alias matrices.
+//G is taken over the design points.
+static List evaluateDesignCriteria(const List& designs, const Eigen::MatrixXd* momentsmatrix,
+                                   const Eigen::MatrixXd* vInv, const List* aliasmatrices) {
+  int numberdesigns = designs.size();
+  Eigen::VectorXd D(numberdesigns), A(numberdesigns), I(numberdesigns), T(numberdesigns),
+                  E(numberdesigns), G(numberdesigns), alias(numberdesigns);
+  I.setConstant(NA_REAL);
+  alias.setConstant(NA_REAL);
+  for(int i = 0; i < numberdesigns; i++) {
+    Eigen::MatrixXd X = as<Eigen::MatrixXd>(designs[i]);
+    double numberrows = X.rows();
+    double numbercols = X.cols();
+    Eigen::MatrixXd vInvX;
+    if(vInv) {
+      if(vInv->rows() != X.rows()) {
+        throw std::runtime_error("Design does not have the same number of runs as the variance-covariance matrix");
+      }
+      vInvX = (*vInv) * X;
+    } else {
+      vInvX = X;
+    }
+    Eigen::MatrixXd XtX = X.transpose() * vInvX;
+    Eigen::PartialPivLU<Eigen::MatrixXd> lu = XtX.partialPivLu();
+    Eigen::MatrixXd XtXinv = lu.inverse();
+    //log|det(X'X)| from the LU factors, so the D-efficiency doesn't overflow for large designs
+    double logdet = lu.matrixLU().diagonal().array().abs().log().sum();
+    D(i) = 100 * exp(logdet / numbercols) / numberrows;
+    A(i) = 100 * numbercols / (numberrows * XtXinv.trace());
+    if(momentsmatrix) {
+      I(i) = (XtXinv * (*momentsmatrix)).trace();
+    }
+    T(i) = XtX.trace();
+    E(i) = Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd>(XtX, Eigen::EigenvaluesOnly).eigenvalues().minCoeff();
+    //Diagonal of X(X'V^-1X)^-1X'V^-1, without forming the N x N matrix
+    Eigen::VectorXd leverage = (X * XtXinv).cwiseProduct(vInvX).rowwise().sum();
+    G(i) = 100 * numbercols / (numberrows * leverage.maxCoeff());
+    if(aliasmatrices) {
+      Eigen::MatrixXd aliasmatrix = as<Eigen::MatrixXd>((*aliasmatrices)[i]);
+      alias(i) = (XtXinv * (vInvX.transpose() * aliasmatrix)).squaredNorm();
+    }
+  }
+  return(List::create(_["D"] = D, _["A"] = A, _["I"] = I, _["T"] = T, _["E"] = E, _["G"] = G, _["alias"] = alias));
 }
 
+//`@title designCriteria
+//`@param designs List of designs in model matrix form.
+//`@param momentsmatrix The moment matrix, or NULL to skip I-optimality.
+//`@param V The variance-covariance matrix of the runs, or NULL for an unblocked design.
+//`@param aliasmatrices List of alias model matrices (one per design), or NULL to skip the alias trace.
+//`@return List of the D, A, I, T, E, G, and alias criteria of each design.
+// [[Rcpp::export]]
+List designCriteria(List designs, Nullable<NumericMatrix> momentsmatrix, Nullable<NumericMatrix> V,
+                    Nullable<List> aliasmatrices) {
+  Eigen::MatrixXd moments, vInv;
+  List aliaslist;
+  if(momentsmatrix.isNotNull()) {
+    moments = as<Eigen::MatrixXd>(momentsmatrix.get());
+  }
+  if(V.isNotNull()) {
+    vInv = as<Eigen::MatrixXd>(V.get()).colPivHouseholderQr().inverse();
+  }
+  if(aliasmatrices.isNotNull()) {
+    aliaslist = List(aliasmatrices.get());
+    if(aliaslist.size() != designs.size()) {
+      throw std::runtime_error("Need one alias matrix per design");
+    }
+  }
+  return(evaluateDesignCriteria(designs, momentsmatrix.isNotNull() ? &moments : NULL, V.isNotNull() ? &vInv : NULL,
+                                aliasmatrices.isNotNull() ? &aliaslist : NULL));
+}
 
+//`@title designSessionCriteria
+//`@param session External pointer returned by createDesignSession.
+//`@param designs List of designs in model matrix form.
+//`@param aliasmatrices List of alias model matrices (one per design), or NULL to skip the alias trace.
+//`@return List of the D, A, I, T, E, G, and alias criteria of each design, using the session's moments matrix
+//`and V^-1.
+// [[Rcpp::export]]
+List designSessionCriteria(SEXP session, List designs, Nullable<List> aliasmatrices) {
+  XPtr<DesignSession> sessionptr(session);
+  List aliaslist;
+  if(aliasmatrices.isNotNull()) {
+    aliaslist = List(aliasmatrices.get());
+    if(aliaslist.size() != designs.size()) {
+      throw std::runtime_error("Need one alias matrix per design");
+    }
+  }
+  return(evaluateDesignCriteria(designs, &sessionptr->momentsmatrix, sessionptr->blocked ? &sessionptr->cache.vInv : NULL,
+                                aliasmatrices.isNotNull() ? &aliaslist : NULL));
+}
+
+//`@title exchangeSearch
+//`@param design The design in model matrix form.
+//`@param candidatelist The candidate set in model matrix form.
+//`@param row The design row (1-based) to search exchanges for.
+//`@param condition "E" or "G".
+//`@return List with the candidate (1-based, 0 if no exchange improves the criterion) chosen by the E- or
+//`G-optimal candidate scan of gen_design, and the criterion after that exchange.
+// [[Rcpp::export]]
+List exchangeSearch(const Eigen::MatrixXd& design, const Eigen::MatrixXd& candidatelist, int row,
+                    const std::string condition) {
+  Eigen::MatrixXd candidatelist_trans = candidatelist.transpose();
+  int entryy = 0;
+  bool found = false;
+  double del = 0;
+  if(condition == "E") {
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigensolver(design.transpose()*design);
+    Eigen::MatrixXd Qtcandidates = eigensolver.eigenvectors().transpose()*candidatelist_trans;
+    Eigen::VectorXd Qtx = eigensolver.eigenvectors().transpose()*design.row(row - 1).transpose();
+    del = eigensolver.eigenvalues().minCoeff();
+    search_candidate_set_E(eigensolver.eigenvalues(), Qtcandidates, Qtx, Eigen::VectorXd::Zero(design.cols()), 1,
+                           entryy, found, del);
+  } else if(condition == "G") {
+    Eigen::MatrixXd V = (design.transpose()*design).partialPivLu().inverse();
+    Eigen::MatrixXd XV = design*V;
+    Eigen::VectorXd designvariances = XV.cwiseProduct(design).rowwise().sum();
+    del = calculateGOptimality(V, design);
+    search_candidate_set_G(V, XV, designvariances, design, candidatelist_trans, row - 1, entryy, found, del);
+  } else {
+    throw std::runtime_error("exchangeSearch only supports E and G");
+  }
+  return(List::create(_["entry"] = found ? entryy + 1 : 0, _["criterion"] = del));
+}
+
+//`@title dExchangePass
+//`@param design The design in model matrix form.
+//`@param candidatelist The candidate set in model matrix form.
+//`@return List with the candidates (1-based, 0 for no exchange) the bounded D-optimal scan of gen_design chose
+//`for each row during one pass of exchanges, and the candidates a full scan of every candidate chose on the same
+//`design and V.
+// [[Rcpp::export]]
+List dExchangePass(Eigen::MatrixXd design, const Eigen::MatrixXd& candidatelist) {
+  int nTrials = design.rows();
+  Eigen::MatrixXd design_trans = design.transpose();
+  Eigen::MatrixXd candidatelist_trans = candidatelist.transpose();
+  Eigen::MatrixXd V = (design.transpose()*design).partialPivLu().inverse();
+  Eigen::MatrixXd identitymat = Eigen::MatrixXd::Identity(2,2);
+  Eigen::MatrixXd f1(design.cols(),2);
+  Eigen::MatrixXd f2(design.cols(),2);
+  Eigen::MatrixXd f2vinv(2,design.cols());
+  Eigen::VectorXd candidatevariances;
+  CandidateOrder candidateorder;
+  calculateCandidateVariances(V, candidatelist, candidatevariances, candidateorder);
+  IntegerVector entries(nTrials);
+  IntegerVector fullentries(nTrials);
+  for (int i = 0; i < nTrials; i++) {
+    double xVx = design_trans.col(i).dot(V * design_trans.col(i));
+    int entryy = 0;
+    bool found = false;
+    double del = 0;
+    search_candidate_set(V, candidatelist_trans, candidatevariances, candidateorder, design_trans.col(i), xVx,
+                         entryy, found, del);
+    double fulldel = 0;
+    for (int j = 0; j < candidatelist_trans.cols(); j++) {
+      Eigen::VectorXd yV = V * candidatelist_trans.col(j);
+      double newdel = yV.dot(candidatelist_trans.col(j))*(1 - xVx) - xVx + pow(yV.dot(design_trans.col(i)),2);
+      if(newdel > fulldel) {
+        fullentries[i] = j + 1;
+        fulldel = newdel;
+      }
+    }
+    if(found) {
+      entries[i] = entryy + 1;
+      updateCandidateVariances(V, candidatelist_trans, design_trans.col(i), candidatelist_trans.col(entryy),
+                               candidatevariances, candidateorder);
+      rankUpdate(V, design_trans.col(i), candidatelist_trans.col(entryy), identitymat, f1, f2, f2vinv);
+      design_trans.col(i) = candidatelist_trans.col(entryy);
+    }
+  }
+  return(List::create(_["entries"] = entries, _["fullentries"] = fullentries));
+}
@@ -0,0 +1,94 @@
+#include <RcppEigen.h>
+// [[Rcpp::depends(RcppEigen)]]
+#include <vector>
+#include <algorithm>
+
+#include "candidateSource.h"
+
+using namespace Rcpp;
+
+//Cholesky factor of the information matrix X'V^-1X, so the prediction variance x'(X'V^-1X)^-1x of a point
+//is the squared norm of L^-1x.
+static Eigen::LLT<Eigen::MatrixXd> informationFactor(const Eigen::MatrixXd& designmm, const Eigen::MatrixXd& V) {
+  if(V.rows() != designmm.rows() || V.cols() != designmm.rows()) {
+    throw std::runtime_error("Variance-covariance matrix does not match the number of runs in the design");
+  }
+  Eigen::MatrixXd information = designmm.transpose() * V.partialPivLu().solve(designmm);
+  Eigen::LLT<Eigen::MatrixXd> llt(information);
+  if(llt.info() != Eigen::Success) {
+    throw std::runtime_error("Singular information matrix: prediction variances can't be calculated for this design");
+  }
+  return(llt);
+}
+
+//`@title predictionVariances
+//`@param designmm The design in model matrix form.
+//`@param V The variance-covariance matrix of the runs.
+//`@param points The points in model matrix form.
+//`@param blocksize The number of points solved at a time.
+//`@return The prediction variance of each point.
+// [[Rcpp::export]]
+Eigen::VectorXd predictionVariances(const Eigen::MatrixXd& designmm, const Eigen::MatrixXd& V,
+                                    const Eigen::MatrixXd& points, int blocksize) {
+  Eigen::LLT<Eigen::MatrixXd> llt = informationFactor(designmm, V);
+  if(points.cols() != designmm.cols()) {
+    throw std::runtime_error("Points and design have different numbers of model matrix columns");
+  }
+  Eigen::VectorXd variances(points.rows());
+  Eigen::MatrixXd block;
+  for(int start = 0; start < points.rows(); start += blocksize) {
+    int count = std::min(blocksize, (int)points.rows() - start);
+    block = points.middleRows(start, count).transpose();
+    llt.matrixL().solveInPlace(block);
+    variances.segment(start, count) = block.colwise().squaredNorm().transpose();
+  }
+  return(variances);
+}
+
+//`@title fdsPredictionVariances
+//`@param designmm The design in model matrix form.
+//`@param V The variance-covariance matrix of the runs.
+//`@param levelcounts The number of levels of each factor in the design space grid (expand.grid order).
+//`@param terms List of model terms, as in genFactorialOptimalDesign.
+//`@param intercept Whether the model has an intercept column.
+//`@param npoints The number of points in the fraction of design space curve.
+//`@param blocksize The number of points generated and solved at a time.
+//`@return The sorted prediction variances of npoints points, which are sampled from the grid when it has more
+//`than npoints points and are otherwise the exact quantiles of the prediction variance over the whole grid.
+// [[Rcpp::export]]
+Eigen::VectorXd fdsPredictionVariances(const Eigen::MatrixXd& designmm, const Eigen::MatrixXd& V,
+                                       IntegerVector levelcounts, List terms, bool intercept,
+                                       int npoints, int blocksize) {
+  RNGScope rngScope;
+  CandidateSource grid = candidateSourceFromList(levelcounts, terms, intercept, Eigen::MatrixXi(0, levelcounts.size()));
+  if(grid.cols() != designmm.cols()) {
+    throw std::runtime_error("Design space grid and design have different numbers of model matrix columns");
+  }
+  Eigen::LLT<Eigen::MatrixXd> llt = informationFactor(designmm, V);
+  //Enumerate the grid when it's no bigger than the curve, otherwise sample it with replacement
+  bool enumerate = grid.size() <= npoints;
+  long long totalpoints = enumerate ? grid.size() : npoints;
+  std::vector<double> variances(totalpoints);
+  std::vector<int> levelindices;
+  Eigen::MatrixXd block(grid.cols(), blocksize);
+  for(long long start = 0; start < totalpoints; start += blocksize) {
+    Rcpp::checkUserInterrupt();
+    int count = std::min((long long)blocksize, totalpoints - start);
+    for(int j = 0; j < count; j++) {
+      long long index = enumerate ? start + j : (long long)(grid.size() * unif_rand());
+      grid.levels(index, levelindices);
+      grid.row(levelindices, block.col(j).data());
+    }
+    Eigen::Block<Eigen::MatrixXd, Eigen::Dynamic, Eigen::Dynamic, true> points = block.leftCols(count);
+    llt.matrixL().solveInPlace(points);
+    for(int j = 0; j < count; j++) {
+      variances[start + j] = points.col(j).squaredNorm();
+    }
+  }
+  std::sort(variances.begin(), variances.end());
+  Eigen::VectorXd curve(npoints);
+  for(int i = 0; i < npoints; i++) {
+    curve(i) = variances[(long long)i * totalpoints / npoints];
+  }
+  return(curve);
+}
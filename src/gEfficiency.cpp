@@ -0,0 +1,304 @@
+#include <RcppEigen.h>
+// [[Rcpp::depends(RcppEigen)]]
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "threadPool.h"
+
+using namespace Rcpp;
+
+//One model term over the continuous design region: the product of powers of numeric factors times the
+//Kronecker product of the codings of its categorical factors.
+struct ContinuousTerm {
+  std::vector<int> numeric;
+  std::vector<double> powers;
+  std::vector<int> factors;
+  std::vector<Eigen::MatrixXd> codings;
+  int cols;
+};
+
+//Builds the model matrix row (and its Jacobian with respect to the numeric factors) of any point in the
+//design region: numeric factors anywhere in [-1, 1], categorical factors at one of their levels.
+class ContinuousModel {
+public:
+  ContinuousModel(int numericcount, const IntegerVector& levelcounts, const List& terms, bool intercept) :
+    numericcount(numericcount), levelcounts(levelcounts.begin(), levelcounts.end()), intercept(intercept) {
+    numbercols = intercept ? 1 : 0;
+    for(int t = 0; t < terms.size(); t++) {
+      List term = terms[t];
+      IntegerVector numeric = term["numeric"];
+      NumericVector powers = term["powers"];
+      IntegerVector factors = term["factors"];
+      List codings = term["codings"];
+      ContinuousTerm newterm;
+      newterm.cols = 1;
+      for(int k = 0; k < numeric.size(); k++) {
+        if(numeric[k] < 0 || numeric[k] >= numericcount) {
+          throw std::runtime_error("Model term refers to a numeric factor that is not in the design");
+        }
+        newterm.numeric.push_back(numeric[k]);
+        newterm.powers.push_back(powers[k]);
+      }
+      for(int k = 0; k < factors.size(); k++) {
+        if(factors[k] < 0 || factors[k] >= (int)this->levelcounts.size()) {
+          throw std::runtime_error("Model term refers to a categorical factor that is not in the design");
+        }
+        Eigen::MatrixXd coding = as<Eigen::MatrixXd>(codings[k]);
+        if(coding.rows() != this->levelcounts[factors[k]]) {
+          throw std::runtime_error("Factor coding needs one row per factor level");
+        }
+        newterm.factors.push_back(factors[k]);
+        newterm.codings.push_back(coding);
+        newterm.cols *= coding.cols();
+      }
+      numbercols += newterm.cols;
+      modelterms.push_back(newterm);
+    }
+  }
+
+  int cols() const {
+    return(numbercols);
+  }
+
+  long long combinations() const {
+    long long total = 1;
+    for(size_t i = 0; i < levelcounts.size(); i++) {
+      total *= levelcounts[i];
+    }
+    return(total);
+  }
+
+  void levels(long long index, std::vector<int>& levelindices) const {
+    levelindices.resize(levelcounts.size());
+    for(size_t i = 0; i < levelcounts.size(); i++) {
+      levelindices[i] = index % levelcounts[i];
+      index /= levelcounts[i];
+    }
+  }
+
+  int levelcount(int factor) const {
+    return(levelcounts[factor]);
+  }
+
+  int factorcount() const {
+    return(levelcounts.size());
+  }
+
+  void row(const Eigen::VectorXd& x, const std::vector<int>& levelindices, Eigen::VectorXd& out,
+           Eigen::MatrixXd& jacobian) const {
+    out.resize(numbercols);
+    jacobian.setZero(numbercols, numericcount);
+    int offset = 0;
+    if(intercept) {
+      out(offset++) = 1;
+    }
+    Eigen::VectorXd categorical;
+    std::vector<double> values;
+    for(size_t t = 0; t < modelterms.size(); t++) {
+      const ContinuousTerm& term = modelterms[t];
+      //Categorical part, with the first factor's columns varying fastest (the order used by model.matrix)
+      categorical.setOnes(term.cols);
+      int termsize = 1;
+      for(size_t k = 0; k < term.factors.size(); k++) {
+        const Eigen::MatrixXd& coding = term.codings[k];
+        int level = levelindices[term.factors[k]];
+        for(int j = coding.cols() - 1; j >= 0; j--) {
+          double value = coding(level, j);
+          for(int e = 0; e < termsize; e++) {
+            categorical(e + termsize*j) = categorical(e)*value;
+          }
+        }
+        termsize *= coding.cols();
+      }
+      //Numeric part and its partial derivatives by the product rule
+      values.resize(term.numeric.size());
+      double scalar = 1;
+      for(size_t k = 0; k < term.numeric.size(); k++) {
+        values[k] = std::pow(x(term.numeric[k]), term.powers[k]);
+        scalar *= values[k];
+      }
+      out.segment(offset, term.cols) = scalar * categorical;
+      for(size_t k = 0; k < term.numeric.size(); k++) {
+        double derivative = term.powers[k] * std::pow(x(term.numeric[k]), term.powers[k] - 1);
+        for(size_t m = 0; m < term.numeric.size(); m++) {
+          if(m != k) {
+            derivative *= values[m];
+          }
+        }
+        jacobian.col(term.numeric[k]).segment(offset, term.cols) += derivative * categorical;
+      }
+      offset += term.cols;
+    }
+  }
+
+private:
+  int numericcount;
+  std::vector<int> levelcounts;
+  std::vector<ContinuousTerm> modelterms;
+  bool intercept;
+  int numbercols;
+};
+
+//Prediction variance x'(X'X)^-1x of a point and its gradient with respect to the numeric factors.
+static double predictionVariance(const ContinuousModel& model, const Eigen::LLT<Eigen::MatrixXd>& llt,
+                                 const Eigen::VectorXd& x, const std::vector<int>& levelindices,
+                                 Eigen::VectorXd& gradient) {
+  Eigen::VectorXd point;
+  Eigen::MatrixXd jacobian;
+  model.row(x, levelindices, point, jacobian);
+  Eigen::VectorXd solved = llt.solve(point);
+  gradient = 2 * jacobian.transpose() * solved;
+  return(point.dot(solved));
+}
+
+//Projected gradient ascent of the prediction variance over [-1, 1] for the numeric factors, with the step
+//doubled after every improving step and halved after every failed one.
+static double maximizeNumeric(const ContinuousModel& model, const Eigen::LLT<Eigen::MatrixXd>& llt,
+                              Eigen::VectorXd& x, const std::vector<int>& levelindices, int maxiterations) {
+  Eigen::VectorXd gradient, newgradient;
+  double variance = predictionVariance(model, llt, x, levelindices, gradient);
+  if(x.size() == 0) {
+    return(variance);
+  }
+  double step = 1;
+  for(int iteration = 0; iteration < maxiterations && step > 1e-12; iteration++) {
+    Eigen::VectorXd newx = (x + step * gradient).cwiseMax(-1).cwiseMin(1);
+    if((newx - x).squaredNorm() == 0) {
+      break; //At a vertex with the gradient pointing out of the region
+    }
+    double newvariance = predictionVariance(model, llt, newx, levelindices, newgradient);
+    if(newvariance > variance) {
+      x = newx;
+      gradient = newgradient;
+      variance = newvariance;
+      step *= 2;
+    } else {
+      step /= 2;
+    }
+  }
+  return(variance);
+}
+
+//`@title gEfficiencyMaximum
+//`@param designmm The design in model matrix form.
+//`@param numericcount The number of numeric factors, each ranging over [-1, 1].
+//`@param levelcounts The number of levels of each categorical factor.
+//`@param terms List of model terms, each a list with `numeric` (0-based numeric factor indices), `powers` (the
+//`power of each numeric factor), `factors` (0-based categorical factor indices) and `codings` (one matrix per
+//`categorical factor with a row for each level).
+//`@param intercept Whether the model has an intercept column.
+//`@param starts The number of random starting points of the search.
+//`@param maxiterations The maximum number of gradient steps from each starting point.
+//`@param threads The number of native threads to search on.
+//`@return List with the G-efficiency, the maximum prediction variance, and the point where it is attained.
+// [[Rcpp::export]]
+List gEfficiencyMaximum(const Eigen::MatrixXd& designmm, int numericcount, IntegerVector levelcounts, List terms,
+                        bool intercept, int starts, int maxiterations, int threads) {
+  RNGScope rngScope;
+  ContinuousModel model(numericcount, levelcounts, terms, intercept);
+  if(model.cols() != designmm.cols()) {
+    throw std::runtime_error("Model terms and design have different numbers of model matrix columns");
+  }
+  Eigen::LLT<Eigen::MatrixXd> llt(designmm.transpose() * designmm);
+  if(llt.info() != Eigen::Success) {
+    throw std::runtime_error("Singular information matrix: G-efficiency can't be calculated for this design");
+  }
+  //Cycle through every combination of categorical levels if there are no more of them than starting points.
+  //The starting points are drawn here from R's RNG, since unif_rand() can't be called on the worker threads.
+  long long combinations = model.combinations();
+  bool enumerate = combinations <= starts;
+  std::vector<long long> startlevels(starts);
+  Eigen::MatrixXd startx(numericcount, starts);
+  for(int start = 0; start < starts; start++) {
+    startlevels[start] = enumerate ? start % combinations : (long long)(combinations * unif_rand());
+    for(int i = 0; i < numericcount; i++) {
+      startx(i, start) = 2 * unif_rand() - 1;
+    }
+  }
+  //The searches run on the native thread pool, in blocks so the user can interrupt between them
+  std::vector<double> startvariances(starts);
+  std::vector<std::vector<int> > startlevelindices(starts);
+  const int blocksize = 256;
+  for(int blockstart = 0; blockstart < starts; blockstart += blocksize) {
+    Rcpp::checkUserInterrupt();
+    parallelFor(threads, blockstart, std::min(starts, blockstart + blocksize), [&](int begin, int end) {
+      Eigen::VectorXd x(numericcount), gradient;
+      std::vector<int> levelindices;
+      for(int start = begin; start < end; start++) {
+        model.levels(startlevels[start], levelindices);
+        x = startx.col(start);
+        double variance = maximizeNumeric(model, llt, x, levelindices, maxiterations);
+        //Alternate with changing one categorical factor at a time until neither improves the variance
+        bool improved = true;
+        while(improved) {
+          improved = false;
+          for(int f = 0; f < model.factorcount(); f++) {
+            int currentlevel = levelindices[f];
+            for(int level = 0; level < model.levelcount(f); level++) {
+              if(level == currentlevel) {
+                continue;
+              }
+              levelindices[f] = level;
+              double newvariance = predictionVariance(model, llt, x, levelindices, gradient);
+              if(newvariance > variance * (1 + 1e-12)) {
+                variance = newvariance;
+                currentlevel = level;
+                improved = true;
+              }
+            }
+            levelindices[f] = currentlevel;
+          }
+          if(improved) {
+            variance = maximizeNumeric(model, llt, x, levelindices, maxiterations);
+          }
+        }
+        startvariances[start] = variance;
+        startx.col(start) = x;
+        startlevelindices[start] = levelindices;
+      }
+    });
+  }
+  //Reduce in start order, so the result doesn't depend on the number of threads
+  double maxvariance = -1;
+  Eigen::VectorXd bestx;
+  std::vector<int> bestlevels;
+  for(int start = 0; start < starts; start++) {
+    if(startvariances[start] > maxvariance) {
+      maxvariance = startvariances[start];
+      bestx = startx.col(start);
+      bestlevels = startlevelindices[start];
+    }
+  }
+  IntegerVector levels(bestlevels.size());
+  for(size_t i = 0; i < bestlevels.size(); i++) {
+    levels[i] = bestlevels[i] + 1;
+  }
+  double gefficiency = 100 * (double)designmm.cols() / ((double)designmm.rows() * maxvariance);
+  return(List::create(_["gefficiency"] = gefficiency, _["variance"] = maxvariance, _["x"] = bestx, _["levels"] = levels));
+}
+
+//`@title continuousModelRows
+//`@param x Matrix of numeric factor values (one column per numeric factor).
+//`@param levelindices Integer matrix of 0-based categorical level indices (one column per categorical factor).
+//`@param levelcounts The number of levels of each categorical factor.
+//`@param terms List of model terms, as in gEfficiencyMaximum.
+//`@param intercept Whether the model has an intercept column.
+//`@return The model matrix rows of the points.
+// [[Rcpp::export]]
+Eigen::MatrixXd continuousModelRows(const Eigen::MatrixXd& x, const Eigen::MatrixXi& levelindices,
+                                    IntegerVector levelcounts, List terms, bool intercept) {
+  ContinuousModel model(x.cols(), levelcounts, terms, intercept);
+  Eigen::MatrixXd rows(x.rows(), model.cols());
+  Eigen::VectorXd point;
+  Eigen::MatrixXd jacobian;
+  std::vector<int> levels(levelindices.cols());
+  for(int i = 0; i < x.rows(); i++) {
+    for(int j = 0; j < levelindices.cols(); j++) {
+      levels[j] = levelindices(i, j);
+    }
+    model.row(x.row(i).transpose(), levels, point, jacobian);
+    rows.row(i) = point;
+  }
+  return(rows);
+}
@@ -0,0 +1,62 @@
+#include <RcppEigen.h>
+// [[Rcpp::depends(RcppEigen)]]
+#include <vector>
+#include <cmath>
+
+#include "effectTests.h"
+
+using namespace Rcpp;
+
+//`@title gaussianMonteCarlo
+//`@param X The model matrix, which must have full column rank and more rows than columns.
+//`@param responses The simulated responses, one column per simulation.
+//`@param hypotheses List of the hypothesis matrix of each effect.
+//`@return List with the least squares `estimates`, their `stderrors` and t-test `pvals` (one row per
+//`simulation), and the Type-III F-test `effectpvals` of each effect. These match fitting each simulation
+//`with lm() and car::Anova(type = "III").
+// [[Rcpp::export]]
+List gaussianMonteCarlo(const Eigen::MatrixXd& X, const Eigen::MatrixXd& responses, List hypotheses) {
+  int n = X.rows();
+  int p = X.cols();
+  int nsim = responses.cols();
+  if(responses.rows() != n) {
+    throw std::runtime_error("Responses and model matrix have different numbers of runs");
+  }
+  //One QR decomposition serves every simulation: all the response columns are solved together
+  Eigen::ColPivHouseholderQR<Eigen::MatrixXd> qr(X);
+  if(qr.rank() < p || n <= p) {
+    throw std::runtime_error("Model matrix must have full column rank and more runs than parameters");
+  }
+  Eigen::MatrixXd estimates = qr.solve(responses);
+  double df = n - p;
+  Eigen::VectorXd sigma2 = (responses - X * estimates).colwise().squaredNorm().transpose() / df;
+
+  //(X'X)^-1 = P R^-1 R^-T P'
+  Eigen::MatrixXd Rinv = qr.matrixR().topLeftCorner(p, p).triangularView<Eigen::Upper>()
+    .solve(Eigen::MatrixXd::Identity(p, p));
+  Eigen::MatrixXd XtXinv = qr.colsPermutation() * (Rinv * Rinv.transpose()) * qr.colsPermutation().transpose();
+
+  Eigen::MatrixXd stderrors(nsim, p);
+  Eigen::MatrixXd pvals(nsim, p);
+  for(int j = 0; j < p; j++) {
+    double scale = std::sqrt(XtXinv(j, j));
+    for(int i = 0; i < nsim; i++) {
+      double se = scale * std::sqrt(sigma2(i));
+      stderrors(i, j) = se;
+      pvals(i, j) = 2 * R::pt(-std::fabs(estimates(j, i) / se), df, 1, 0);
+    }
+  }
+
+  //Type-III F test of each effect: (Lb)'(L(X'X)^-1L')^-1(Lb) / (q sigma^2), for all simulations at once
+  std::vector<Eigen::MatrixXd> L = hypothesisMatrices(hypotheses, p);
+  Eigen::MatrixXd statistics = sharedCovarianceStatistics(L, XtXinv, estimates);
+  Eigen::MatrixXd effectpvals(nsim, L.size());
+  for(size_t e = 0; e < L.size(); e++) {
+    int q = L[e].rows();
+    for(int i = 0; i < nsim; i++) {
+      effectpvals(i, e) = R::pf(statistics(e, i) / (q * sigma2(i)), q, df, 0, 0);
+    }
+  }
+  return(List::create(_["estimates"] = Eigen::MatrixXd(estimates.transpose()), _["stderrors"] = stderrors,
+                      _["pvals"] = pvals, _["effectpvals"] = effectpvals));
+}
@@ -0,0 +1,213 @@
+#include <RcppEigen.h>
+// [[Rcpp::depends(RcppEigen)]]
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "optimalityfunctions.h"
+#include "candidateSource.h"
+
+using namespace Rcpp;
+
+//Random candidate index. One unif_rand() only has about 32 bits of resolution, too few to reach every candidate
+//of a large factorial, so two draws are combined.
+long long randomCandidateIndex(long long totalPoints) {
+  double u = (std::floor(unif_rand()*4294967296.0) + unif_rand())/4294967296.0;
+  return(std::min((long long)(u*totalPoints), totalPoints - 1));
+}
+
+//Scores the first ntile candidates of tile_trans as D-optimal exchanges for a design row, keeping the best.
+void scoreCandidateTile(const Eigen::MatrixXd& V, const Eigen::VectorXd& Vx, double xVx,
+                        const Eigen::MatrixXd& tile_trans, const std::vector<long long>& tileindices, int ntile,
+                        bool& found, long long& entryy, Eigen::VectorXd& best, double& del) {
+  Eigen::Ref<const Eigen::MatrixXd> tile = tile_trans.leftCols(ntile);
+  Eigen::VectorXd newdel = (V * tile).cwiseProduct(tile).colwise().sum().transpose()*(1 - xVx);
+  newdel.array() += (tile.transpose() * Vx).array().square() - xVx;
+  for (int j = 0; j < ntile; j++) {
+    if(newdel(j) > del) {
+      found = true;
+      entryy = tileindices[j];
+      best = tile_trans.col(j);
+      del = newdel(j);
+    }
+  }
+}
+
+//`@title genFactorialOptimalDesign
+//`@param levelcounts The number of levels of each factor; candidates are the full factorial in expand.grid order.
+//`@param terms List of model terms, each a list with `factors` (0-based factor indices) and `codings` (one matrix per
+//`factor with a row for each level and a column for each model matrix column the factor contributes).
+//`@param intercept Whether the model has an intercept column.
+//`@param disallowed Integer matrix of disallowed combinations of 0-based level indices, with -1 matching any level.
+//`@param trials The number of runs in the design.
+//`@param tolerance Stopping tolerance for fractional increase in optimality criteria.
+//`@param tilesize The number of candidates generated at a time during the exchange search.
+//`@param samplesize Full factorials with more candidates than this are not scanned in full: each row is instead
+//`compared against the candidates that differ from it in one factor and `samplesize` randomly drawn candidates.
+//`@return List of design information, with indices (starting at 1) into the full factorial.
+// [[Rcpp::export]]
+List genFactorialOptimalDesign(IntegerVector levelcounts, List terms, bool intercept,
+                               const Eigen::MatrixXi& disallowed, int trials, double tolerance, int tilesize,
+                               int samplesize) {
+  RNGScope rngScope;
+  CandidateSource candidates = candidateSourceFromList(levelcounts, terms, intercept, disallowed);
+  int nTrials = trials;
+  double numberrows = trials;
+  double numbercols = candidates.cols();
+  long long totalPoints = candidates.size();
+  if(nTrials < candidates.cols()) {
+    throw std::runtime_error("Too few runs to generate initial non-singular matrix: increase the number of runs or decrease the number of parameters in the matrix");
+  }
+
+  //Draw random allowed candidates until the initial design is non-singular.
+  Eigen::MatrixXd design_trans(candidates.cols(), nTrials);
+  std::vector<long long> designindices(nTrials);
+  std::vector<int> levelindices;
+  Eigen::VectorXd candidate;
+  int maxSingularityChecks = nTrials*100;
+  int maxDraws = nTrials*1000;
+  bool singular = true;
+  for (int check = 0; check < maxSingularityChecks && singular; check++) {
+    for (int i = 0; i < nTrials; i++) {
+      int draws = 0;
+      long long index;
+      do {
+        if(draws++ == maxDraws) {
+          throw std::runtime_error("Unable to draw an allowed candidate: disallowed combinations exclude nearly the entire candidate set");
+        }
+        index = randomCandidateIndex(totalPoints);
+        candidates.levels(index, levelindices);
+      } while(!candidates.allowed(levelindices));
+      candidates.row(index, candidate);
+      design_trans.col(i) = candidate;
+      designindices[i] = index;
+    }
+    singular = isSingular(design_trans.transpose());
+  }
+  if (singular) {
+    return(List::create(_["indices"] = NumericVector::get_na(), _["modelmatrix"] = NumericMatrix::get_na(), _["criterion"] = NumericVector::get_na()));
+  }
+
+  bool found = true;
+  double del = 0;
+  long long entryy = 0;
+  double newOptimum = 0;
+  double priorOptimum = 0;
+  double minDelta = tolerance;
+  double xVx;
+  int designversion = 0;
+  std::vector<int> rowscanversion(nTrials, -1);
+
+  Eigen::MatrixXd identitymat(2,2);
+  identitymat.setIdentity(2,2);
+  Eigen::MatrixXd f1(candidates.cols(),2);
+  Eigen::MatrixXd f2(candidates.cols(),2);
+  Eigen::MatrixXd f2vinv(2,candidates.cols());
+
+  Eigen::MatrixXd V = (design_trans*design_trans.transpose()).partialPivLu().inverse();
+  Eigen::MatrixXd tile_trans(candidates.cols(), tilesize);
+  Eigen::VectorXd best;
+  std::vector<long long> tileindices;
+  //Sampled scans differ from one pass to the next, so a row with no exchange is only skipped in full scans.
+  bool fullscan = totalPoints <= samplesize;
+
+  newOptimum = calculateDOptimality(design_trans.transpose());
+  if(std::isinf(newOptimum)) {
+    newOptimum = exp(calculateDOptimalityLog(design_trans.transpose()));
+  }
+  priorOptimum = newOptimum/2;
+  while((newOptimum - priorOptimum)/priorOptimum > minDelta) {
+    priorOptimum = newOptimum;
+    for (int i = 0; i < nTrials; i++) {
+      if(fullscan && rowscanversion[i] == designversion) {
+        continue;
+      }
+      found = false;
+      del = 0;
+      xVx = design_trans.col(i).transpose() * V * design_trans.col(i);
+      Eigen::VectorXd Vx = V * design_trans.col(i);
+      if(fullscan) {
+        //Generate the candidates a tile at a time and score each tile with matrix products.
+        for (long long start = 0; start < totalPoints; ) {
+          Rcpp::checkUserInterrupt();
+          start = candidates.tile(start, tilesize, tile_trans, tileindices);
+          scoreCandidateTile(V, Vx, xVx, tile_trans, tileindices, tileindices.size(), found, entryy, best, del);
+        }
+      } else {
+        //The candidates one factor away from the row, then random draws, filled into tiles as they are generated.
+        tileindices.clear();
+        auto addCandidate = [&](long long index) {
+          candidates.row(levelindices, tile_trans.col(tileindices.size()).data());
+          tileindices.push_back(index);
+          if((int)tileindices.size() == tilesize) {
+            Rcpp::checkUserInterrupt();
+            scoreCandidateTile(V, Vx, xVx, tile_trans, tileindices, tilesize, found, entryy, best, del);
+            tileindices.clear();
+          }
+        };
+        std::vector<int> rowlevels;
+        candidates.levels(designindices[i], rowlevels);
+        for (int factor = 0; factor < (int)rowlevels.size(); factor++) {
+          levelindices = rowlevels;
+          for (int level = 0; level < levelcounts[factor]; level++) {
+            levelindices[factor] = level;
+            if(level != rowlevels[factor] && candidates.allowed(levelindices)) {
+              addCandidate(candidates.index(levelindices));
+            }
+          }
+        }
+        for (int draw = 0; draw < samplesize; draw++) {
+          long long index = randomCandidateIndex(totalPoints);
+          candidates.levels(index, levelindices);
+          if(candidates.allowed(levelindices)) {
+            addCandidate(index);
+          }
+        }
+        if(!tileindices.empty()) {
+          scoreCandidateTile(V, Vx, xVx, tile_trans, tileindices, tileindices.size(), found, entryy, best, del);
+        }
+      }
+      if (found) {
+        designversion++;
+        rankUpdate(V,design_trans.col(i),best,identitymat,f1,f2,f2vinv);
+        design_trans.col(i) = best;
+        designindices[i] = entryy;
+        newOptimum = newOptimum * (1 + del);
+      } else {
+        rowscanversion[i] = designversion;
+      }
+    }
+  }
+  Eigen::MatrixXd design = design_trans.transpose();
+  newOptimum = calculateDEff(design,numbercols,numberrows);
+  if(std::isinf(newOptimum)) {
+    newOptimum = calculateDEffLog(design,numbercols,numberrows);
+  }
+  NumericVector indices(nTrials);
+  for (int i = 0; i < nTrials; i++) {
+    indices[i] = designindices[i] + 1; //R indexes start at 1
+  }
+  return(List::create(_["indices"] = indices, _["modelmatrix"] = design, _["criterion"] = newOptimum));
+}
+
+//`@title factorialCandidateRows
+//`@param levelcounts The number of levels of each factor; candidates are the full factorial in expand.grid order.
+//`@param terms List of model terms, as in genFactorialOptimalDesign.
+//`@param intercept Whether the model has an intercept column.
+//`@param indices Indices (starting at 1) of the candidates in the full factorial.
+//`@return The model matrix rows of the requested candidates.
+// [[Rcpp::export]]
+Eigen::MatrixXd factorialCandidateRows(IntegerVector levelcounts, List terms, bool intercept, NumericVector indices) {
+  CandidateSource candidates = candidateSourceFromList(levelcounts, terms, intercept, Eigen::MatrixXi(0, levelcounts.size()));
+  Eigen::MatrixXd rows(indices.size(), candidates.cols());
+  Eigen::VectorXd candidate;
+  for (int i = 0; i < indices.size(); i++) {
+    long long index = (long long)indices[i] - 1;
+    if(index < 0 || index >= candidates.size()) {
+      throw std::runtime_error("Candidate index outside of the full factorial");
+    }
+    candidates.row(index, candidate);
+    rows.row(i) = candidate;
+  }
+  return(rows);
+}
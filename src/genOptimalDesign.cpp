@@ -1,9 +1,12 @@
 #include <RcppEigen.h>
 // [[Rcpp::depends(RcppEigen)]]
 #include <queue>
+#include <numeric>
+#include <algorithm>
 
 #include "optimalityfunctions.h"
 #include "nullify_alg.h"
+#include "designSession.h"
 
 using namespace Rcpp;
 
@@ -21,12 +24,24 @@ using namespace Rcpp;
 //`@param augmentedrows The rows that are fixed during the design search.
 //`@return List of design information.
 // [[Rcpp::export]]
-List genOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixXd& candidatelist,
+List genOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::Map<Eigen::MatrixXd> candidatelist,
                       const std::string condition,
                       const Eigen::MatrixXd& momentsmatrix, Eigen::VectorXd initialRows,
                       Eigen::MatrixXd aliasdesign,
-                      const Eigen::MatrixXd& aliascandidatelist,
+                      const Eigen::Map<Eigen::MatrixXd> aliascandidatelist,
                       double minDopt, double tolerance, int augmentedrows, int kexchange) {
+  CandidateSearchCache cache;
+  prepareCandidateSearch(candidatelist, condition, false, Eigen::MatrixXd(), cache);
+  return(searchOptimalDesign(initialdesign, candidatelist, cache, condition, momentsmatrix, initialRows,
+                             aliasdesign, aliascandidatelist, minDopt, tolerance, augmentedrows, kexchange));
+}
+
+//Design search of genOptimalDesign, with the candidate set precomputation already done in cache.
+List searchOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::Ref<const Eigen::MatrixXd>& candidatelist,
+                         const CandidateSearchCache& cache, const std::string& condition,
+                         const Eigen::MatrixXd& momentsmatrix, Eigen::VectorXd initialRows,
+                         Eigen::MatrixXd aliasdesign, const Eigen::Ref<const Eigen::MatrixXd>& aliascandidatelist,
+                         double minDopt, double tolerance, int augmentedrows, int kexchange) {
   RNGScope rngScope;
   int nTrials = initialdesign.rows();
   double numberrows = initialdesign.rows();
@@ -40,12 +55,6 @@ List genOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixXd& cand
   if(nTrials < candidatelist.cols()) {
     throw std::runtime_error("Too few runs to generate initial non-singular matrix: increase the number of runs or decrease the number of parameters in the matrix");
   }
-  //Check for singularity from a column perfectly correlating with the intercept.
-  for(int j = 1; j < candidatelist.cols(); j++) {
-    if(candidatelist.col(0).cwiseEqual(candidatelist.col(j)).all()) {
-      throw std::runtime_error("Singular model matrix from factor aliased into intercept, revise model");
-    }
-  }
   Eigen::VectorXi shuffledindices;
   //Checks if the initial matrix is singular. If so, randomly generates a new design maxSingularityChecks times.
   for (int check = 0; check < maxSingularityChecks; check++) {
@@ -105,6 +114,14 @@ List genOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixXd& cand
   double minDelta = tolerance;
   double newdel;
   double xVx;
+  //Determinant ratio below which a T-optimal exchange is skipped without the full singularity check.
+  double minExchangeRatio = 1e-10;
+  //Design version at the last scan of each row that found no exchange. Every accepted exchange bumps
+  //designversion, so a row is only rescanned once the design has changed since its last scan. Only this exact
+  //case is skipped: no best delta is cached per row, so any accepted exchange makes every earlier row get a full
+  //rescan (the D-type scans still stop early on their candidate bound).
+  int designversion = 0;
+  std::vector<int> rowscanversion(nTrials, -1);
 
   //Initialize matrices for rank-2 updates.
   Eigen::MatrixXd identitymat(2,2);
@@ -115,8 +132,11 @@ List genOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixXd& cand
 
   //Transpose matrices for faster element access
   Eigen::MatrixXd initialdesign_trans = initialdesign.transpose();
-  Eigen::MatrixXd candidatelist_trans = candidatelist.transpose();
+  const Eigen::MatrixXd& candidatelist_trans = cache.candidatelist_trans;
   Eigen::MatrixXd V = (initialdesign.transpose()*initialdesign).partialPivLu().inverse();
+  //Prediction variances c'Vc of the candidates, largest first, used to bound the D-optimal exchange delta.
+  Eigen::VectorXd candidatevariances;
+  CandidateOrder candidateorder;
   //Generate a D-optimal design
   if(condition == "D" || condition == "G") {
     newOptimum = calculateDOptimality(initialdesign);
@@ -127,6 +147,7 @@ List genOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixXd& cand
 
     while((newOptimum - priorOptimum)/priorOptimum > minDelta) {
       priorOptimum = newOptimum;
+      calculateCandidateVariances(V, candidatelist, candidatevariances, candidateorder);
       //Calculate k-exchange coordinates
       std::priority_queue<std::pair<double, int>> q;
       float min_val = -INFINITY;
@@ -152,15 +173,24 @@ List genOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixXd& cand
         Rcpp::checkUserInterrupt();
         int i = q.top().second;
         q.pop();
+        //Skip rows whose last scan found no exchange if the design has not changed since
+        if(rowscanversion[i] == designversion) {
+          candidateRow[i] = initialRows[i];
+          continue;
+        }
         found = false;
         entryy = 0;
         del=0;
         xVx = initialdesign_trans.col(i).transpose() * V * initialdesign_trans.col(i);
         //Search through all candidate set points to find best switch (if one exists).
 
-        search_candidate_set(V, candidatelist_trans, initialdesign_trans.col(i), xVx, entryy, found, del);
+        search_candidate_set(V, candidatelist_trans, candidatevariances, candidateorder, initialdesign_trans.col(i), xVx,
+                             entryy, found, del);
 
         if (found) {
+          designversion++;
+          updateCandidateVariances(V, candidatelist_trans, initialdesign_trans.col(i), candidatelist_trans.col(entryy),
+                                   candidatevariances, candidateorder);
           //Update the inverse with the rank-2 update formula.
           rankUpdate(V,initialdesign_trans.col(i),candidatelist_trans.col(entryy),identitymat,f1,f2,f2vinv);
 
@@ -171,6 +201,7 @@ List genOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixXd& cand
           newOptimum = newOptimum * (1 + del);
         } else {
           candidateRow[i] = initialRows[i];
+          rowscanversion[i] = designversion;
         }
       }
     }
@@ -189,6 +220,11 @@ List genOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixXd& cand
       priorOptimum = newOptimum;
       for (int i = augmentedrows; i < nTrials; i++) {
         Rcpp::checkUserInterrupt();
+        //Skip rows whose last scan found no exchange if the design has not changed since
+        if(rowscanversion[i] == designversion) {
+          candidateRow[i] = initialRows[i];
+          continue;
+        }
         found = false;
         entryx = 0;
         entryy = 0;
@@ -202,6 +238,7 @@ List genOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixXd& cand
           }
         }
         if (found) {
+          designversion++;
           //Exchange points
           rankUpdate(V,initialdesign_trans.col(entryx),candidatelist_trans.col(entryy),identitymat,f1,f2,f2vinv);
           initialdesign_trans.col(entryx) = candidatelist_trans.col(entryy);
@@ -209,6 +246,7 @@ List genOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixXd& cand
           initialRows[i] = entryy+1;
         } else {
           candidateRow[i] = initialRows[i];
+          rowscanversion[i] = designversion;
         }
       }
       //Re-calculate current criterion value
@@ -225,6 +263,11 @@ List genOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixXd& cand
       priorOptimum = newOptimum;
       for (int i = augmentedrows; i < nTrials; i++) {
         Rcpp::checkUserInterrupt();
+        //Skip rows whose last scan found no exchange if the design has not changed since
+        if(rowscanversion[i] == designversion) {
+          candidateRow[i] = initialRows[i];
+          continue;
+        }
         found = false;
         entryx = 0;
         entryy = 0;
@@ -238,6 +281,7 @@ List genOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixXd& cand
           }
         }
         if (found) {
+          designversion++;
           //Exchange points
           rankUpdate(V,initialdesign_trans.col(entryx),candidatelist_trans.col(entryy),identitymat,f1,f2,f2vinv);
           initialdesign_trans.col(entryx) = candidatelist_trans.col(entryy);
@@ -245,6 +289,7 @@ List genOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixXd& cand
           initialRows[i] = entryy+1;
         } else {
           candidateRow[i] = initialRows[i];
+          rowscanversion[i] = designversion;
         }
       }
       //Re-calculate current criterion value.
@@ -263,15 +308,25 @@ List genOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixXd& cand
 
     while((newOptimum - priorOptimum)/priorOptimum > minDelta) {
       priorOptimum = newOptimum;
+      calculateCandidateVariances(V, candidatelist, candidatevariances, candidateorder);
       for (int i = augmentedrows; i < nTrials; i++) {
         Rcpp::checkUserInterrupt();
+        //Skip rows whose last scan found no exchange if the design has not changed since
+        if(rowscanversion[i] == designversion) {
+          candidateRow[i] = initialRows[i];
+          continue;
+        }
         found = false;
         entryy = 0;
         del=0;
         xVx = initialdesign_trans.col(i).transpose() * V * initialdesign_trans.col(i);
         //Search through candidate set for potential exchanges for row i
-        search_candidate_set(V, candidatelist_trans, initialdesign_trans.col(i), xVx, entryy, found, del);
+        search_candidate_set(V, candidatelist_trans, candidatevariances, candidateorder, initialdesign_trans.col(i), xVx,
+                             entryy, found, del);
         if (found) {
+          designversion++;
+          updateCandidateVariances(V, candidatelist_trans, initialdesign_trans.col(i), candidatelist_trans.col(entryy),
+                                   candidatevariances, candidateorder);
           //Update the inverse with the rank-2 update formula.
           rankUpdate(V,initialdesign_trans.col(i),candidatelist_trans.col(entryy),identitymat,f1,f2,f2vinv);
 
@@ -283,6 +338,7 @@ List genOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixXd& cand
           newOptimum = newOptimum * (1 + del);
         } else {
           candidateRow[i] = initialRows[i];
+          rowscanversion[i] = designversion;
         }
       }
     }
@@ -371,44 +427,40 @@ List genOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixXd& cand
     newOptimum = bestA;
   }
   if(condition == "G") {
-    Eigen::MatrixXd temp;
+    //The D-optimal warm start above left rows marked as scanned, so clear them for the G-optimal scan.
+    rowscanversion.assign(nTrials, -1);
     del = calculateGOptimality(V,initialdesign);
     newOptimum = del;
     priorOptimum = del*2;
+    //X*V and the prediction variances at the design points are only recomputed after an exchange is accepted.
+    Eigen::MatrixXd XV = initialdesign*V;
+    Eigen::VectorXd designvariances = XV.cwiseProduct(initialdesign).rowwise().sum();
     while((newOptimum - priorOptimum)/priorOptimum < -minDelta) {
       priorOptimum = newOptimum;
       for (int i = augmentedrows; i < nTrials; i++) {
         Rcpp::checkUserInterrupt();
+        //Skip rows whose last scan found no exchange if the design has not changed since
+        if(rowscanversion[i] == designversion) {
+          candidateRow[i] = initialRows[i];
+          continue;
+        }
         found = false;
-        entryx = 0;
         entryy = 0;
-        temp = initialdesign;
         //Search through candidate set for potential exchanges for row i
-        for (int j = 0; j < totalPoints; j++) {
-          //Checks for singularity; If singular, moves to next candidate in the candidate set
-          try {
-            temp.row(i) = candidatelist.row(j);
-            newdel = calculateGOptimality(rankUpdateValue(V,initialdesign_trans.col(i),candidatelist_trans.col(j),identitymat,f1,f2,f2vinv),temp);
-            if(newdel < del) {
-              if(!isSingular(temp)) {
-                found = true;
-                entryx = i; entryy = j;
-                del = newdel;
-              }
-            }
-          } catch (std::runtime_error& e) {
-            continue;
-          }
-        }
+        search_candidate_set_G(V, XV, designvariances, initialdesign, candidatelist_trans, i, entryy, found, del);
         if (found) {
+          designversion++;
           //Exchange points
           rankUpdate(V,initialdesign_trans.col(i),candidatelist_trans.col(entryy),identitymat,f1,f2,f2vinv);
-          initialdesign.row(entryx) = candidatelist.row(entryy);
-          initialdesign_trans.col(entryx) = candidatelist_trans.col(entryy);
+          initialdesign.row(i) = candidatelist.row(entryy);
+          initialdesign_trans.col(i) = candidatelist_trans.col(entryy);
+          XV = initialdesign*V;
+          designvariances = XV.cwiseProduct(initialdesign).rowwise().sum();
           candidateRow[i] = entryy+1;
           initialRows[i] = entryy+1;
         } else {
           candidateRow[i] = initialRows[i];
+          rowscanversion[i] = designversion;
         }
       }
       //Re-calculate current criterion value.
@@ -416,37 +468,47 @@ List genOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixXd& cand
     }
   }
   if(condition == "T") {
-    Eigen::MatrixXd temp;
     del = calculateTOptimality(initialdesign);
     newOptimum = del;
     priorOptimum = newOptimum/2;
+    //Squared norms of the candidates and their order (largest first) are fixed for the whole search.
+    Eigen::VectorXd candidatenorms = candidatelist.rowwise().squaredNorm();
+    std::vector<int> candidateorder(totalPoints);
+    std::iota(candidateorder.begin(), candidateorder.end(), 0);
+    std::stable_sort(candidateorder.begin(), candidateorder.end(),
+                     [&candidatenorms](int a, int b) {return(candidatenorms(a) > candidatenorms(b));});
+    Eigen::MatrixXd XtX;
     while((newOptimum - priorOptimum)/priorOptimum > minDelta) {
       priorOptimum = newOptimum;
+      //X'X and V are only used to reject exchanges that make the design singular.
+      XtX = initialdesign.transpose()*initialdesign;
+      V = XtX.partialPivLu().inverse();
       for (int i = augmentedrows; i < nTrials; i++) {
         Rcpp::checkUserInterrupt();
+        //Skip rows whose last scan found no exchange if the design has not changed since
+        if(rowscanversion[i] == designversion) {
+          candidateRow[i] = initialRows[i];
+          continue;
+        }
         found = false;
-        entryx = 0;
         entryy = 0;
-        temp = initialdesign;
+        del = 0;
         //Search through candidate set for potential exchanges for row i
-        for (int j = 0; j < totalPoints; j++) {
-          temp.row(i) = candidatelist.row(j);
-          newdel = calculateTOptimality(temp);
-          if(newdel > del) {
-            if(!isSingular(temp)) {
-              found = true;
-              entryx = i; entryy = j;
-              del = newdel;
-            }
-          }
-        }
+        search_candidate_set_T(V, XtX, candidatelist_trans, candidatenorms, candidateorder,
+                               initialdesign_trans.col(i), minExchangeRatio, entryy, found, del);
         if (found) {
+          designversion++;
           //Exchange points
-          initialdesign.row(entryx) = candidatelist.row(entryy);
+          XtX += candidatelist_trans.col(entryy)*candidatelist_trans.col(entryy).transpose() -
+            initialdesign_trans.col(i)*initialdesign_trans.col(i).transpose();
+          V = XtX.partialPivLu().inverse();
+          initialdesign_trans.col(i) = candidatelist_trans.col(entryy);
+          initialdesign.row(i) = candidatelist.row(entryy);
           candidateRow[i] = entryy+1;
           initialRows[i] = entryy+1;
         } else {
           candidateRow[i] = initialRows[i];
+          rowscanversion[i] = designversion;
         }
       }
       //Re-calculate current criterion value.
@@ -454,37 +516,43 @@ List genOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixXd& cand
     }
   }
   if(condition == "E") {
-    Eigen::MatrixXd temp;
     del = calculateEOptimality(initialdesign);
     newOptimum = del;
     priorOptimum = newOptimum/2;
+    //Keep the eigendecomposition of X'X and the candidates/design rows expressed in its eigenbasis;
+    //these are only recomputed after an exchange is accepted.
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigensolver(initialdesign.transpose()*initialdesign);
+    Eigen::MatrixXd Qtcandidates = eigensolver.eigenvectors().transpose()*candidatelist_trans;
+    Eigen::MatrixXd Qtdesign = eigensolver.eigenvectors().transpose()*initialdesign_trans;
+    Eigen::VectorXd Qts = Eigen::VectorXd::Zero(initialdesign.cols());
     while((newOptimum - priorOptimum)/priorOptimum > minDelta) {
       priorOptimum = newOptimum;
       for (int i = augmentedrows; i < nTrials; i++) {
         Rcpp::checkUserInterrupt();
+        //Skip rows whose last scan found no exchange if the design has not changed since
+        if(rowscanversion[i] == designversion) {
+          candidateRow[i] = initialRows[i];
+          continue;
+        }
         found = false;
-        entryx = 0;
         entryy = 0;
-        temp = initialdesign;
         //Search through candidate set for potential exchanges for row i
-        for (int j = 0; j < totalPoints; j++) {
-          temp.row(i) = candidatelist.row(j);
-          newdel = calculateEOptimality(temp);
-          if(newdel > del) {
-            if(!isSingular(temp)) {
-              found = true;
-              entryx = i; entryy = j;
-              del = newdel;
-            }
-          }
-        }
+        search_candidate_set_E(eigensolver.eigenvalues(), Qtcandidates, Qtdesign.col(i), Qts, 1,
+                               entryy, found, del);
         if (found) {
-          //Exchange points
-          initialdesign.row(entryx) = candidatelist.row(entryy);
+          designversion++;
+          //Exchange points and re-decompose the information matrix
+          initialdesign.row(i) = candidatelist.row(entryy);
+          initialdesign_trans.col(i) = candidatelist_trans.col(entryy);
+          eigensolver.compute(initialdesign.transpose()*initialdesign);
+          Qtcandidates = eigensolver.eigenvectors().transpose()*candidatelist_trans;
+          Qtdesign = eigensolver.eigenvectors().transpose()*initialdesign_trans;
+          del = eigensolver.eigenvalues().minCoeff();
           candidateRow[i] = entryy+1;
           initialRows[i] = entryy+1;
         } else {
           candidateRow[i] = initialRows[i];
+          rowscanversion[i] = designversion;
         }
       }
       //Re-calculate current criterion value.
@@ -21,10 +21,10 @@ using namespace Rcpp;
 //`@param tolerance Stopping tolerance for fractional increase in optimality criteria.
 //`@return List of design information.
 // [[Rcpp::export]]
-List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd candidatelist, const Eigen::MatrixXd& blockeddesign,
+List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::Map<Eigen::MatrixXd> candidatelist, const Eigen::MatrixXd& blockeddesign,
                                const std::string condition, const Eigen::MatrixXd& momentsmatrix, Eigen::VectorXi& initialRows,
                                const Eigen::MatrixXd& blockedVar,
-                               Eigen::MatrixXd aliasdesign, Eigen::MatrixXd aliascandidatelist, double minDopt, List interactions,
+                               Eigen::MatrixXd aliasdesign, const Eigen::Map<Eigen::MatrixXd> aliascandidatelist, double minDopt, List interactions,
                                const Eigen::MatrixXd disallowed, const bool anydisallowed, double tolerance, int kexchange) {
   //Load the R RNG
   RNGScope rngScope;
@@ -141,6 +141,11 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
   double interactiontempval;
   double interactiontempvalalias;
   bool pointallowed = false;
+  //Design version at the last scan of each row that found no exchange. Every accepted exchange bumps
+  //designversion, so a row is only rescanned once the design has changed since its last scan.
+  //Rows that must change are always rescanned, and any accepted exchange makes the earlier rows rescan in full.
+  int designversion = 0;
+  std::vector<int> rowscanversion(nTrials, -1);
   //Generate a D-optimal design, fixing the blocking factors
   if(condition == "D") {
     Eigen::MatrixXd temp;
@@ -178,6 +183,11 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
         Rcpp::checkUserInterrupt();
         int i = q.top().second;
         q.pop();
+        //Skip rows whose last scan found no exchange if the design has not changed since
+        if(!mustchange[i] && rowscanversion[i] == designversion) {
+          candidateRow(i) = initialRows(i);
+          continue;
+        }
         found = false;
         entryx = 0;
         entryy = 0;
@@ -219,6 +229,7 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
           }
         }
         if (found) {
+          designversion++;
           combinedDesign.block(entryx, blockedCols, 1, designCols) = candidatelist.row(entryy);
           //Calculate interaction terms for sub-whole plot interactions
           if(interstrata) {
@@ -234,6 +245,7 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
           initialRows(i) = entryy+1;
         } else {
           candidateRow(i) = initialRows(i);
+          rowscanversion[i] = designversion;
         }
       }
       newOptimum = calculateBlockedDOptimality(combinedDesign, vInv);
@@ -252,6 +264,11 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
       priorOptimum = newOptimum;
       for (int i = 0; i < nTrials; i++) {
         Rcpp::checkUserInterrupt();
+        //Skip rows whose last scan found no exchange if the design has not changed since
+        if(!mustchange[i] && rowscanversion[i] == designversion) {
+          candidateRow(i) = initialRows(i);
+          continue;
+        }
         found = false;
         entryx = 0;
         entryy = 0;
@@ -293,6 +310,7 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
           }
         }
         if (found) {
+          designversion++;
           combinedDesign.block(entryx, blockedCols, 1, designCols) = candidatelist.row(entryy);
           //Calculate interaction terms for sub-whole plot interactions
           if(interstrata) {
@@ -308,6 +326,7 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
           initialRows(i) = entryy+1;
         } else {
           candidateRow(i) = initialRows(i);
+          rowscanversion[i] = designversion;
         }
       }
       try {
@@ -327,6 +346,11 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
       priorOptimum = newOptimum;
       for (int i = 0; i < nTrials; i++) {
         Rcpp::checkUserInterrupt();
+        //Skip rows whose last scan found no exchange if the design has not changed since
+        if(!mustchange[i] && rowscanversion[i] == designversion) {
+          candidateRow(i) = initialRows(i);
+          continue;
+        }
         found = false;
         entryx = 0;
         entryy = 0;
@@ -368,6 +392,7 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
           }
         }
         if (found) {
+          designversion++;
           combinedDesign.block(entryx, blockedCols, 1, designCols) = candidatelist.row(entryy);
           //Calculate interaction terms for sub-whole plot interactions
           if(interstrata) {
@@ -383,6 +408,7 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
           initialRows(i) = entryy+1;
         } else {
           candidateRow(i) = initialRows(i);
+          rowscanversion[i] = designversion;
         }
       }
       newOptimum = calculateBlockedAOptimality(combinedDesign,vInv);
@@ -397,6 +423,11 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
       del = calculateBlockedTOptimality(combinedDesign,vInv);
       for (int i = 0; i < nTrials; i++) {
         Rcpp::checkUserInterrupt();
+        //Skip rows whose last scan found no exchange if the design has not changed since
+        if(!mustchange[i] && rowscanversion[i] == designversion) {
+          candidateRow(i) = initialRows(i);
+          continue;
+        }
         found = false;
         entryx = 0;
         entryy = 0;
@@ -436,6 +467,7 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
           }
         }
         if (found) {
+          designversion++;
           combinedDesign.block(entryx, blockedCols, 1, designCols) = candidatelist.row(entryy);
           //Calculate interaction terms for sub-whole plot interactions
           if(interstrata) {
@@ -451,6 +483,7 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
           initialRows(i) = entryy+1;
         } else {
           candidateRow(i) = initialRows(i);
+          rowscanversion[i] = designversion;
         }
       }
       newOptimum = calculateBlockedTOptimality(combinedDesign, vInv);
@@ -467,6 +500,11 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
       del = calculateBlockedEOptimality(combinedDesign,vInv);
       for (int i = 0; i < nTrials; i++) {
         Rcpp::checkUserInterrupt();
+        //Skip rows whose last scan found no exchange if the design has not changed since
+        if(!mustchange[i] && rowscanversion[i] == designversion) {
+          candidateRow(i) = initialRows(i);
+          continue;
+        }
         found = false;
         entryx = 0;
         entryy = 0;
@@ -510,6 +548,7 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
           }
         }
         if (found) {
+          designversion++;
           combinedDesign.block(entryx, blockedCols, 1, designCols) = candidatelist.row(entryy);
           //Calculate interaction terms for sub-whole plot interactions
           if(interstrata) {
@@ -525,6 +564,7 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
           initialRows(i) = entryy+1;
         } else {
           candidateRow(i) = initialRows(i);
+          rowscanversion[i] = designversion;
         }
       }
       newOptimum = calculateBlockedEOptimality(combinedDesign, vInv);
@@ -539,6 +579,11 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
       priorOptimum = newOptimum;
       for (int i = 0; i < nTrials; i++) {
         Rcpp::checkUserInterrupt();
+        //Skip rows whose last scan found no exchange if the design has not changed since
+        if(!mustchange[i] && rowscanversion[i] == designversion) {
+          candidateRow(i) = initialRows(i);
+          continue;
+        }
         found = false;
         entryx = 0;
         entryy = 0;
@@ -582,6 +627,7 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
           }
         }
         if (found) {
+          designversion++;
           combinedDesign.block(entryx, blockedCols, 1, designCols) = candidatelist.row(entryy);
           //Calculate interaction terms for sub-whole plot interactions
           if(interstrata) {
@@ -597,6 +643,7 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
           initialRows(i) = entryy+1;
         } else {
           candidateRow(i) = initialRows(i);
+          rowscanversion[i] = designversion;
         }
       }
       newOptimum = calculateBlockedGOptimality(combinedDesign, vInv);
@@ -615,6 +662,11 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
       del = calculateBlockedDOptimality(combinedDesign,vInv);
       for (int i = 0; i < nTrials; i++) {
         Rcpp::checkUserInterrupt();
+        //Skip rows whose last scan found no exchange if the design has not changed since
+        if(!mustchange[i] && rowscanversion[i] == designversion) {
+          candidateRow(i) = initialRows(i);
+          continue;
+        }
         found = false;
         entryx = 0;
         entryy = 0;
@@ -652,6 +704,7 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
           }
         }
         if (found) {
+          designversion++;
           combinedDesign.block(entryx, blockedCols, 1, designCols) = candidatelist.row(entryy);
           combinedAliasDesign.block(entryx, blockedCols, 1, designColsAlias) = aliascandidatelist.row(entryy);
           //Calculate interaction terms for sub-whole plot interactions
@@ -671,6 +724,7 @@ List genSplitPlotOptimalDesign(Eigen::MatrixXd initialdesign, Eigen::MatrixXd ca
           initialRows(i) = entryy+1;
         } else {
           candidateRow(i) = initialRows(i);
+          rowscanversion[i] = designversion;
         }
       }
       newOptimum = calculateBlockedDOptimality(combinedDesign, vInv);
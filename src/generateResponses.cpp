@@ -0,0 +1,239 @@
+#include <RcppEigen.h>
+// [[Rcpp::depends(RcppEigen)]]
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+
+#include "threadPool.h"
+
+using namespace Rcpp;
+
+enum ResponseFamily { GAUSSIAN, BINOMIAL, POISSON, EXPONENTIAL };
+
+static ResponseFamily responseFamily(const std::string& family) {
+  if(family == "gaussian") {
+    return(GAUSSIAN);
+  }
+  if(family == "binomial") {
+    return(BINOMIAL);
+  }
+  if(family == "poisson") {
+    return(POISSON);
+  }
+  if(family == "exponential") {
+    return(EXPONENTIAL);
+  }
+  throw std::runtime_error("Unsupported family for the response generator: " + family);
+}
+
+static uint64_t splitmix64(uint64_t& state) {
+  uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return(z ^ (z >> 31));
+}
+
+//xoshiro256** stream for one simulation. Each simulation's stream is seeded from the run seed and the
+//simulation's index, so the responses don't depend on how the simulations are tiled or spread over threads.
+class SimulationRng {
+public:
+  SimulationRng(uint64_t seed, uint64_t simulation) : hasspare(false) {
+    uint64_t state = seed ^ (simulation * 0xD1B54A32D192ED03ULL);
+    for(int i = 0; i < 4; i++) {
+      s[i] = splitmix64(state);
+    }
+  }
+
+  //Uniform on (0, 1)
+  double uniform() {
+    return(((next() >> 11) + 0.5) * (1.0 / 9007199254740992.0));
+  }
+
+  //Standard normal (Marsaglia's polar method)
+  double normal() {
+    if(hasspare) {
+      hasspare = false;
+      return(spare);
+    }
+    double u, v, r;
+    do {
+      u = 2 * uniform() - 1;
+      v = 2 * uniform() - 1;
+      r = u * u + v * v;
+    } while(r >= 1);
+    double scale = std::sqrt(-2 * std::log(r) / r);
+    spare = v * scale;
+    hasspare = true;
+    return(u * scale);
+  }
+
+  double exponential() {
+    return(-std::log(uniform()));
+  }
+
+  double poisson(double lambda);
+
+private:
+  uint64_t next() {
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return(result);
+  }
+
+  static uint64_t rotl(uint64_t x, int k) {
+    return((x << k) | (x >> (64 - k)));
+  }
+
+  uint64_t s[4];
+  bool hasspare;
+  double spare;
+};
+
+//log(k!), from a table for small k and Stirling's series otherwise (std::lgamma isn't thread-safe everywhere)
+static double logFactorial(double k) {
+  static const double table[10] = {0, 0, 0.69314718055994531, 1.7917594692280550, 3.1780538303479458,
+                                   4.7874917427820460, 6.5792512120101010, 8.5251613610654143,
+                                   10.604602902745251, 12.801827480081469};
+  if(k < 10) {
+    return(table[(int)k]);
+  }
+  double inv = 1 / k;
+  double inv2 = inv * inv;
+  return(k * std::log(k) - k + 0.5 * std::log(2 * M_PI * k) +
+         inv * (1.0 / 12 - inv2 * (1.0 / 360 - inv2 / 1260)));
+}
+
+//Poisson draw: inversion for small means, Hormann's transformed rejection (PTRS) for larger ones
+double SimulationRng::poisson(double lambda) {
+  if(!(lambda > 0)) {
+    return(lambda == 0 ? 0 : std::numeric_limits<double>::quiet_NaN());
+  }
+  if(!std::isfinite(lambda)) {
+    return(std::numeric_limits<double>::quiet_NaN());
+  }
+  if(lambda < 10) {
+    double k = 0;
+    double probability = std::exp(-lambda);
+    double cumulative = probability;
+    double u = uniform();
+    while(u > cumulative && probability > 0) {
+      k++;
+      probability *= lambda / k;
+      cumulative += probability;
+    }
+    return(k);
+  }
+  double slam = std::sqrt(lambda);
+  double loglam = std::log(lambda);
+  double b = 0.931 + 2.53 * slam;
+  double a = -0.059 + 0.02483 * b;
+  double invalpha = 1.1239 + 1.1328 / (b - 3.4);
+  double vr = 0.9277 - 3.6224 / (b - 2);
+  while(true) {
+    double u = uniform() - 0.5;
+    double v = uniform();
+    double us = 0.5 - std::fabs(u);
+    double k = std::floor((2 * a / us + b) * u + lambda + 0.43);
+    if(us >= 0.07 && v <= vr) {
+      return(k);
+    }
+    if(k < 0 || (us < 0.013 && v > us)) {
+      continue;
+    }
+    if(std::log(v) + std::log(invalpha) - std::log(a / (us * us) + b) <= -lambda + k * loglam - logFactorial(k)) {
+      return(k);
+    }
+  }
+}
+
+//`@title generateResponses
+//`@param X The model matrix.
+//`@param b The anticipated coefficients.
+//`@param blocks List with the block membership (1-based) of every run for each blocking layer.
+//`@param blockvariances The variance of the block noise in each layer, relative to the run-to-run variance.
+//`@param family The glm family: "gaussian", "binomial", "poisson" or "exponential".
+//`@param firstsim The index of the first simulation in the tile.
+//`@param count The number of simulations in the tile.
+//`@param seed Seed of the simulation streams.
+//`@param threads The number of native threads to generate on.
+//`@return Matrix of simulated responses, one column per simulation. Each simulation draws one normal noise
+//`term per block in each layer, adds it to the linear predictor of every run in the block, and draws the
+//`responses as the default `rfunction` of `eval_design_mc()` does. Simulation `i` depends only on `seed` and
+//`i`, so a run can be generated in any tiling, on any number of threads, with the same result.
+// [[Rcpp::export]]
+Eigen::MatrixXd generateResponses(const Eigen::MatrixXd& X, const Eigen::VectorXd& b, List blocks,
+                                  NumericVector blockvariances, std::string family, int firstsim, int count,
+                                  int seed, int threads) {
+  int n = X.rows();
+  if(X.cols() != b.size()) {
+    throw std::runtime_error("Wrong number of anticipated coefficients");
+  }
+  if(blocks.size() != blockvariances.size()) {
+    throw std::runtime_error("Need one block variance per blocking layer");
+  }
+  ResponseFamily responsefamily = responseFamily(family);
+  int layers = blocks.size();
+  std::vector<std::vector<int> > membership(layers, std::vector<int>(n));
+  std::vector<int> blockcounts(layers, 0);
+  std::vector<double> blocksd(layers);
+  for(int l = 0; l < layers; l++) {
+    IntegerVector layer = blocks[l];
+    if(layer.size() != n) {
+      throw std::runtime_error("Block membership and model matrix have different numbers of runs");
+    }
+    for(int i = 0; i < n; i++) {
+      if(layer[i] == NA_INTEGER || layer[i] < 1) {
+        throw std::runtime_error("Block membership must be positive integers");
+      }
+      membership[l][i] = layer[i] - 1;
+      blockcounts[l] = std::max(blockcounts[l], (int)layer[i]);
+    }
+    blocksd[l] = std::sqrt(blockvariances[l]);
+  }
+  Eigen::VectorXd meanpredictor = X * b;
+  Eigen::MatrixXd responses(n, count);
+
+  parallelFor(threads, 0, count, [&](int begin, int end) {
+    Eigen::VectorXd eta(n);
+    std::vector<double> blocknoise;
+    for(int j = begin; j < end; j++) {
+      SimulationRng rng((uint64_t)(uint32_t)seed, (uint64_t)firstsim + j);
+      eta = meanpredictor;
+      for(int l = 0; l < layers; l++) {
+        blocknoise.resize(blockcounts[l]);
+        for(int k = 0; k < blockcounts[l]; k++) {
+          blocknoise[k] = blocksd[l] * rng.normal();
+        }
+        for(int i = 0; i < n; i++) {
+          eta(i) += blocknoise[membership[l][i]];
+        }
+      }
+      for(int i = 0; i < n; i++) {
+        switch(responsefamily) {
+          case GAUSSIAN:
+            responses(i, j) = eta(i) + rng.normal();
+            break;
+          case BINOMIAL:
+            responses(i, j) = rng.uniform() < 1 / (1 + std::exp(-eta(i))) ? 1 : 0;
+            break;
+          case POISSON:
+            responses(i, j) = rng.poisson(std::exp(eta(i)));
+            break;
+          case EXPONENTIAL:
+            responses(i, j) = std::exp(eta(i)) * rng.exponential();
+            break;
+        }
+      }
+    }
+  });
+  return(responses);
+}
@@ -1,5 +1,6 @@
 #include "optimalityfunctions.h"
 #include "nullify_alg.h"
+#include "designSession.h"
 
 #include <RcppEigen.h>
 #include <queue>
@@ -19,12 +20,25 @@ using namespace Rcpp;
 //`@param augmentedrows The rows that are fixed during the design search.
 //`@return List of design information.
 // [[Rcpp::export]]
-List genBlockedOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixXd& candidatelist,
+List genBlockedOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::Map<Eigen::MatrixXd> candidatelist,
                              const std::string condition, Eigen::MatrixXd V,
                              const Eigen::MatrixXd& momentsmatrix,  Eigen::VectorXi& initialRows,
                              Eigen::MatrixXd aliasdesign,
-                             const Eigen::MatrixXd& aliascandidatelist,
+                             const Eigen::Map<Eigen::MatrixXd> aliascandidatelist,
                              double minDopt, double tolerance, int augmentedrows, int kexchange) {
+  CandidateSearchCache cache;
+  prepareCandidateSearch(candidatelist, condition, true, V, cache);
+  return(searchBlockedOptimalDesign(initialdesign, candidatelist, cache, condition, V, momentsmatrix, initialRows,
+                                    aliasdesign, aliascandidatelist, minDopt, tolerance, augmentedrows, kexchange));
+}
+
+//Design search of genBlockedOptimalDesign, with the candidate set precomputation and V^-1 already in cache.
+List searchBlockedOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::Ref<const Eigen::MatrixXd>& candidatelist,
+                                const CandidateSearchCache& cache, const std::string& condition,
+                                const Eigen::MatrixXd& V, const Eigen::MatrixXd& momentsmatrix,
+                                Eigen::VectorXi& initialRows, Eigen::MatrixXd aliasdesign,
+                                const Eigen::Ref<const Eigen::MatrixXd>& aliascandidatelist,
+                                double minDopt, double tolerance, int augmentedrows, int kexchange) {
   RNGScope rngScope;
   int nTrials = initialdesign.rows();
   double numbercols = initialdesign.cols();
@@ -34,17 +48,11 @@ List genBlockedOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixX
   Eigen::VectorXi candidateRow = initialRows;
   Eigen::MatrixXd test(initialdesign.cols(), initialdesign.cols());
   test.setZero();
-  const Eigen::MatrixXd vInv = V.colPivHouseholderQr().inverse();
+  const Eigen::MatrixXd& vInv = cache.vInv;
 
   if(nTrials < candidatelist.cols()) {
     throw std::runtime_error("Too few runs to generate initial non-singular matrix: increase the number of runs or decrease the number of parameters in the matrix");
   }
-  //Check for singularity from a column perfectly correlating with the intercept.
-  for(int j = 1; j < candidatelist.cols(); j++) {
-    if(candidatelist.col(0).cwiseEqual(candidatelist.col(j)).all()) {
-      throw std::runtime_error("Singular model matrix from factor aliased into intercept, revise model");
-    }
-  }
   Eigen::VectorXi shuffledindices;
   //Checks if the initial matrix is singular. If so, randomly generates a new design maxSingularityChecks times.
   for (int check = 0; check < maxSingularityChecks; check++) {
@@ -103,6 +111,10 @@ List genBlockedOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixX
   double priorOptimum = 0;
   double minDelta = tolerance;
   double newdel;
+  //Design version at the last scan of each row that found no exchange. Every accepted exchange bumps
+  //designversion, so a row is only rescanned once the design has changed since its last scan, and then in full.
+  int designversion = 0;
+  std::vector<int> rowscanversion(nTrials, -1);
 
   //Initialize matrices for rank-2 updates.
   Eigen::MatrixXd identitymat(2,2);
@@ -113,7 +125,7 @@ List genBlockedOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixX
 
   //Transpose matrices for faster element access
   Eigen::MatrixXd initialdesign_trans = initialdesign.transpose();
-  Eigen::MatrixXd candidatelist_trans = candidatelist.transpose();
+  const Eigen::MatrixXd& candidatelist_trans = cache.candidatelist_trans;
   // Eigen::MatrixXd V = (initialdesign.transpose()*initialdesign).partialPivLu().inverse();
 
   //Generate a D-optimal design
@@ -154,6 +166,11 @@ List genBlockedOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixX
         Rcpp::checkUserInterrupt();
         int i = q.top().second;
         q.pop();
+        //Skip rows whose last scan found no exchange if the design has not changed since
+        if(rowscanversion[i] == designversion) {
+          candidateRow(i) = initialRows(i);
+          continue;
+        }
         found = false;
         entryx = 0;
         entryy = 0;
@@ -173,11 +190,13 @@ List genBlockedOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixX
           }
         }
         if (found) {
+          designversion++;
           initialdesign.block(entryx, 0, 1, numbercols) = candidatelist.row(entryy);
           candidateRow(i) = entryy+1;
           initialRows(i) = entryy+1;
         } else {
           candidateRow(i) = initialRows(i);
+          rowscanversion[i] = designversion;
         }
       }
       newOptimum = calculateBlockedDOptimality(initialdesign, vInv);
@@ -196,6 +215,11 @@ List genBlockedOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixX
       priorOptimum = newOptimum;
       for (int i = 0; i < nTrials; i++) {
         Rcpp::checkUserInterrupt();
+        //Skip rows whose last scan found no exchange if the design has not changed since
+        if(rowscanversion[i] == designversion) {
+          candidateRow(i) = initialRows(i);
+          continue;
+        }
         found = false;
         entryx = 0;
         entryy = 0;
@@ -217,11 +241,13 @@ List genBlockedOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixX
           }
         }
         if (found) {
+          designversion++;
           initialdesign.block(entryx, 0, 1, numbercols) = candidatelist.row(entryy);
           candidateRow(i) = entryy+1;
           initialRows(i) = entryy+1;
         } else {
           candidateRow(i) = initialRows(i);
+          rowscanversion[i] = designversion;
         }
       }
       try {
@@ -241,6 +267,11 @@ List genBlockedOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixX
       priorOptimum = newOptimum;
       for (int i = 0; i < nTrials; i++) {
         Rcpp::checkUserInterrupt();
+        //Skip rows whose last scan found no exchange if the design has not changed since
+        if(rowscanversion[i] == designversion) {
+          candidateRow(i) = initialRows(i);
+          continue;
+        }
         found = false;
         entryx = 0;
         entryy = 0;
@@ -262,11 +293,13 @@ List genBlockedOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixX
           }
         }
         if (found) {
+          designversion++;
           initialdesign.block(entryx, 0, 1, numbercols) = candidatelist.row(entryy);
           candidateRow(i) = entryy+1;
           initialRows(i) = entryy+1;
         } else {
           candidateRow(i) = initialRows(i);
+          rowscanversion[i] = designversion;
         }
       }
       newOptimum = calculateBlockedAOptimality(initialdesign,vInv);
@@ -285,6 +318,11 @@ List genBlockedOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixX
       del = calculateBlockedDOptimality(initialdesign,vInv);
       for (int i = 0; i < nTrials; i++) {
         Rcpp::checkUserInterrupt();
+        //Skip rows whose last scan found no exchange if the design has not changed since
+        if(rowscanversion[i] == designversion) {
+          candidateRow(i) = initialRows(i);
+          continue;
+        }
         found = false;
         entryx = 0;
         entryy = 0;
@@ -302,12 +340,14 @@ List genBlockedOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixX
           }
         }
         if (found) {
+          designversion++;
           initialdesign.block(entryx, 0, 1, numbercols) = candidatelist.row(entryy);
           aliasdesign.block(entryx, 0, 1, aliascandidatelist.cols()) = aliascandidatelist.row(entryy);
           candidateRow(i) = entryy+1;
           initialRows(i) = entryy+1;
         } else {
           candidateRow(i) = initialRows(i);
+          rowscanversion[i] = designversion;
         }
       }
       newOptimum = calculateBlockedDOptimality(initialdesign, vInv);
@@ -401,6 +441,11 @@ List genBlockedOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixX
       priorOptimum = newOptimum;
       for (int i = 0; i < nTrials; i++) {
         Rcpp::checkUserInterrupt();
+        //Skip rows whose last scan found no exchange if the design has not changed since
+        if(rowscanversion[i] == designversion) {
+          candidateRow(i) = initialRows(i);
+          continue;
+        }
         found = false;
         entryx = 0;
         entryy = 0;
@@ -423,11 +468,13 @@ List genBlockedOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixX
           }
         }
         if (found) {
+          designversion++;
           initialdesign.block(entryx, 0, 1, numbercols) = candidatelist.row(entryy);
           candidateRow(i) = entryy+1;
           initialRows(i) = entryy+1;
         } else {
           candidateRow(i) = initialRows(i);
+          rowscanversion[i] = designversion;
         }
       }
       newOptimum = calculateBlockedGOptimality(initialdesign, vInv);
@@ -443,6 +490,11 @@ List genBlockedOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixX
       del = calculateBlockedTOptimality(initialdesign,vInv);
       for (int i = 0; i < nTrials; i++) {
         Rcpp::checkUserInterrupt();
+        //Skip rows whose last scan found no exchange if the design has not changed since
+        if(rowscanversion[i] == designversion) {
+          candidateRow(i) = initialRows(i);
+          continue;
+        }
         found = false;
         entryx = 0;
         entryy = 0;
@@ -461,52 +513,65 @@ List genBlockedOptimalDesign(Eigen::MatrixXd initialdesign, const Eigen::MatrixX
           }
         }
         if (found) {
+          designversion++;
           initialdesign.block(entryx, 0, 1, numbercols) = candidatelist.row(entryy);
           candidateRow(i) = entryy+1;
           initialRows(i) = entryy+1;
         } else {
           candidateRow(i) = initialRows(i);
+          rowscanversion[i] = designversion;
         }
       }
       newOptimum = calculateBlockedTOptimality(initialdesign, vInv);
     }
   }
   if(condition == "E") {
-    Eigen::MatrixXd temp;
     newOptimum = calculateBlockedEOptimality(initialdesign, vInv);
     priorOptimum = newOptimum/2;
+    Eigen::MatrixXd XtW;
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigensolver;
+    Eigen::MatrixXd Qtcandidates;
+    Eigen::MatrixXd Qtdesign;
+    Eigen::MatrixXd QtXtW;
     while((newOptimum - priorOptimum)/priorOptimum > minDelta) {
       priorOptimum = newOptimum;
       del = calculateBlockedEOptimality(initialdesign,vInv);
+      //Keep the eigendecomposition of X'V^-1X and the candidates/design rows expressed in its eigenbasis;
+      //these are only recomputed after an exchange is accepted.
+      XtW = initialdesign.transpose()*vInv;
+      eigensolver.compute(XtW*initialdesign);
+      Qtcandidates = eigensolver.eigenvectors().transpose()*candidatelist_trans;
+      Qtdesign = eigensolver.eigenvectors().transpose()*initialdesign.transpose();
+      QtXtW = eigensolver.eigenvectors().transpose()*XtW;
       for (int i = 0; i < nTrials; i++) {
         Rcpp::checkUserInterrupt();
+        //Skip rows whose last scan found no exchange if the design has not changed since
+        if(rowscanversion[i] == designversion) {
+          candidateRow(i) = initialRows(i);
+          continue;
+        }
         found = false;
         entryx = 0;
         entryy = 0;
-        temp = initialdesign;
+        //Off-diagonal GLS contribution of the other rows to the exchanged row
+        Eigen::VectorXd Qts = QtXtW.col(i) - vInv(i,i)*Qtdesign.col(i);
         //Search through candidate set for potential exchanges for row i
-        for (int j = 0; j < totalPoints; j++) {
-          temp.block(i, 0, 1, numbercols) = candidatelist.row(j);
-          //Check if optimality condition improved and can perform exchange
-          try {
-            newdel = calculateBlockedEOptimality(temp, vInv);
-          } catch (std::runtime_error& e) {
-            continue;
-          }
-          if(newdel > del) {
-            if(!isSingularBlocked(temp,vInv)) {
-              found = true;
-              entryx = i; entryy = j;
-              del = newdel;
-            }
-          }
-        }
+        search_candidate_set_E(eigensolver.eigenvalues(), Qtcandidates, Qtdesign.col(i), Qts, vInv(i,i),
+                               entryy, found, del);
         if (found) {
-          initialdesign.block(entryx, 0, 1, numbercols) = candidatelist.row(entryy);
+          designversion++;
+          XtW += (candidatelist.row(entryy) - initialdesign.row(i)).transpose()*vInv.row(i);
+          initialdesign.block(i, 0, 1, numbercols) = candidatelist.row(entryy);
+          eigensolver.compute(XtW*initialdesign);
+          Qtcandidates = eigensolver.eigenvectors().transpose()*candidatelist_trans;
+          Qtdesign = eigensolver.eigenvectors().transpose()*initialdesign.transpose();
+          QtXtW = eigensolver.eigenvectors().transpose()*XtW;
+          del = eigensolver.eigenvalues().minCoeff();
           candidateRow(i) = entryy+1;
           initialRows(i) = entryy+1;
         } else {
           candidateRow(i) = initialRows(i);
+          rowscanversion[i] = designversion;
         }
       }
       newOptimum = calculateBlockedEOptimality(initialdesign, vInv);
@@ -0,0 +1,241 @@
+#include <RcppEigen.h>
+// [[Rcpp::depends(RcppEigen)]]
+#include <vector>
+#include <string>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "effectTests.h"
+#include "threadPool.h"
+
+using namespace Rcpp;
+
+enum FitFamily { BINOMIAL, POISSON, GAMMA, EXPONENTIAL_SURVIVAL };
+
+static FitFamily fitFamily(const std::string& family) {
+  if(family == "binomial") {
+    return(BINOMIAL);
+  }
+  if(family == "poisson") {
+    return(POISSON);
+  }
+  if(family == "exponential") {
+    return(GAMMA);
+  }
+  if(family == "exponential_survival") {
+    return(EXPONENTIAL_SURVIVAL);
+  }
+  throw std::runtime_error("Unsupported family for the batched fitter: " + family);
+}
+
+//Deviance (minus twice the log-likelihood, up to a constant) of the fitted linear predictor, along with the
+//IRLS weights and working responses at that fit. The binomial, poisson and Gamma families use the canonical
+//logit/log and the log link as glm() does; the exponential survival model is survreg(dist = "exponential") with
+//right censoring, where the Newton step is an IRLS step with weights y*exp(-eta).
+static double familyDeviance(FitFamily family, const Eigen::VectorXd& y, const Eigen::VectorXd& events,
+                             const Eigen::VectorXd& eta, Eigen::VectorXd& weights, Eigen::VectorXd& working) {
+  int n = y.size();
+  double deviance = 0;
+  weights.resize(n);
+  working.resize(n);
+  for(int i = 0; i < n; i++) {
+    double mu;
+    switch(family) {
+    case BINOMIAL: {
+      //Same thresholds as binomial()$linkinv
+      double e = std::min(std::max(eta(i), -30.0), 30.0);
+      mu = 1 / (1 + std::exp(-e));
+      weights(i) = std::max(mu * (1 - mu), std::numeric_limits<double>::epsilon());
+      working(i) = eta(i) + (y(i) - mu) / weights(i);
+      deviance -= 2 * (y(i) * std::log(mu) + (1 - y(i)) * std::log(1 - mu));
+      break;
+    }
+    case POISSON:
+      mu = std::exp(eta(i));
+      weights(i) = mu;
+      working(i) = eta(i) + (y(i) - mu) / mu;
+      deviance += 2 * ((y(i) > 0 ? y(i) * std::log(y(i) / mu) : 0) - (y(i) - mu));
+      break;
+    case GAMMA:
+      mu = std::exp(eta(i));
+      weights(i) = 1;
+      working(i) = eta(i) + (y(i) - mu) / mu;
+      deviance -= 2 * (std::log(y(i) / mu) - (y(i) - mu) / mu);
+      break;
+    case EXPONENTIAL_SURVIVAL: {
+      double hazard = y(i) * std::exp(-eta(i));
+      weights(i) = std::max(hazard, std::numeric_limits<double>::min());
+      working(i) = eta(i) + (hazard - events(i)) / weights(i);
+      deviance += 2 * (events(i) * eta(i) + hazard);
+      break;
+    }
+    }
+  }
+  return(deviance);
+}
+
+struct BatchFit {
+  Eigen::VectorXd coefficients;
+  Eigen::MatrixXd covariance;
+  int iterations;
+  bool converged;
+  bool separated;
+};
+
+//Fits one simulated response by IRLS from the starting coefficients, stopping with glm()'s relative deviance
+//criterion and halving steps that give a non-finite deviance.
+static BatchFit fitIRLS(FitFamily family, const Eigen::MatrixXd& X, const Eigen::VectorXd& y,
+                        const Eigen::VectorXd& events, const Eigen::VectorXd& start, int maxiterations,
+                        double tolerance) {
+  int n = X.rows();
+  int p = X.cols();
+  BatchFit fit;
+  fit.coefficients = start;
+  fit.iterations = 0;
+  fit.converged = false;
+  Eigen::VectorXd weights, working, newweights, newworking;
+  Eigen::VectorXd eta = X * start;
+  double deviance = familyDeviance(family, y, events, eta, weights, working);
+  Eigen::MatrixXd weightedX(n, p);
+  Eigen::LLT<Eigen::MatrixXd> llt;
+  while(fit.iterations < maxiterations) {
+    fit.iterations++;
+    weightedX = weights.asDiagonal() * X;
+    llt.compute(X.transpose() * weightedX);
+    if(llt.info() != Eigen::Success) {
+      break;
+    }
+    Eigen::VectorXd newcoefficients = llt.solve(weightedX.transpose() * working);
+    Eigen::VectorXd neweta = X * newcoefficients;
+    double newdeviance = familyDeviance(family, y, events, neweta, newweights, newworking);
+    for(int halving = 0; !std::isfinite(newdeviance) && halving < 30; halving++) {
+      newcoefficients = (newcoefficients + fit.coefficients) / 2;
+      neweta = X * newcoefficients;
+      newdeviance = familyDeviance(family, y, events, neweta, newweights, newworking);
+    }
+    if(!std::isfinite(newdeviance)) {
+      break;
+    }
+    fit.coefficients = newcoefficients;
+    eta = neweta;
+    weights = newweights;
+    working = newworking;
+    bool converged = std::fabs(newdeviance - deviance) / (std::fabs(newdeviance) + 0.1) < tolerance;
+    deviance = newdeviance;
+    if(converged) {
+      fit.converged = true;
+      break;
+    }
+  }
+  //Fitted probabilities at 0 or 1 (as glm() warns about) mean the data are separated
+  fit.separated = false;
+  if(family == BINOMIAL) {
+    double boundary = 10 * std::numeric_limits<double>::epsilon();
+    for(int i = 0; i < n; i++) {
+      double mu = 1 / (1 + std::exp(-eta(i)));
+      if(mu < boundary || mu > 1 - boundary) {
+        fit.separated = true;
+        break;
+      }
+    }
+  }
+  weightedX = weights.asDiagonal() * X;
+  fit.covariance = (X.transpose() * weightedX).ldlt().solve(Eigen::MatrixXd::Identity(p, p));
+  if(family == GAMMA) {
+    //Pearson estimate of the dispersion, as summary.glm() uses
+    Eigen::VectorXd mu = eta.array().exp();
+    double dispersion = ((y - mu).array() / mu.array()).square().sum() / (n - p);
+    fit.covariance *= dispersion;
+  }
+  return(fit);
+}
+
+//`@title glmMonteCarlo
+//`@param X The model matrix, which must have full column rank and more rows than columns.
+//`@param responses The simulated responses (survival times for "exponential_survival"), one column per simulation.
+//`@param events Matrix of event indicators (1 if observed, 0 if right-censored) for "exponential_survival",
+//`otherwise ignored.
+//`@param family One of "binomial", "poisson", "exponential" (a Gamma glm with log link) or
+//`"exponential_survival" (survreg with the exponential distribution).
+//`@param start The starting coefficients of every fit (the anticipated coefficients).
+//`@param hypotheses List of the hypothesis matrix of each effect.
+//`@param maxiterations The maximum number of IRLS iterations per fit.
+//`@param tolerance Convergence tolerance on the relative change in deviance.
+//`@param threads The number of native threads to fit on.
+//`@return List with the `estimates`, `stderrors` and Wald `pvals` (one row per simulation), the Type-III Wald
+//`chi-squared `effectpvals` of each effect, and the `iterations`, `converged` and `separated` status of each fit.
+// [[Rcpp::export]]
+List glmMonteCarlo(const Eigen::MatrixXd& X, const Eigen::MatrixXd& responses, const Eigen::MatrixXd& events,
+                   const std::string family, const Eigen::VectorXd& start, List hypotheses,
+                   int maxiterations, double tolerance, int threads) {
+  FitFamily fitfamily = fitFamily(family);
+  int n = X.rows();
+  int p = X.cols();
+  int nsim = responses.cols();
+  if(responses.rows() != n) {
+    throw std::runtime_error("Responses and model matrix have different numbers of runs");
+  }
+  if(fitfamily == EXPONENTIAL_SURVIVAL && (events.rows() != n || events.cols() != nsim)) {
+    throw std::runtime_error("Event indicators and responses have different dimensions");
+  }
+  if(start.size() != p) {
+    throw std::runtime_error("Wrong number of starting coefficients");
+  }
+  if(n <= p) {
+    throw std::runtime_error("Model matrix must have more runs than parameters");
+  }
+  std::vector<Eigen::MatrixXd> L = hypothesisMatrices(hypotheses, p);
+  int neffects = L.size();
+  double df = n - p;
+  Eigen::MatrixXd estimates(nsim, p);
+  Eigen::MatrixXd stderrors(nsim, p);
+  Eigen::MatrixXd pvals(nsim, p);
+  Eigen::MatrixXd effectpvals(nsim, neffects);
+  std::vector<int> iterationcounts(nsim);
+  std::vector<int> convergedfits(nsim);
+  std::vector<int> separatedfits(nsim);
+  //The fits run on the native thread pool, in blocks so the user can interrupt between them; the statistics are
+  //converted to p-values afterwards on this thread, since the R distribution functions aren't thread-safe
+  const int blocksize = 1024;
+  for(int blockstart = 0; blockstart < nsim; blockstart += blocksize) {
+    Rcpp::checkUserInterrupt();
+    parallelFor(threads, blockstart, std::min(nsim, blockstart + blocksize), [&](int begin, int end) {
+      Eigen::VectorXd noevents;
+      for(int i = begin; i < end; i++) {
+        BatchFit fit = fitIRLS(fitfamily, X, responses.col(i), fitfamily == EXPONENTIAL_SURVIVAL ? events.col(i) : noevents,
+                               start, maxiterations, tolerance);
+        iterationcounts[i] = fit.iterations;
+        convergedfits[i] = fit.converged;
+        separatedfits[i] = fit.separated;
+        estimates.row(i) = fit.coefficients.transpose();
+        for(int j = 0; j < p; j++) {
+          double se = std::sqrt(fit.covariance(j, j));
+          stderrors(i, j) = se;
+          pvals(i, j) = -std::fabs(fit.coefficients(j) / se);
+        }
+        for(int e = 0; e < neffects; e++) {
+          effectpvals(i, e) = waldStatistic(L[e], fit.coefficients, fit.covariance);
+        }
+      }
+    });
+  }
+  IntegerVector iterations(nsim);
+  LogicalVector converged(nsim);
+  LogicalVector separated(nsim);
+  for(int i = 0; i < nsim; i++) {
+    iterations[i] = iterationcounts[i];
+    converged[i] = convergedfits[i];
+    separated[i] = separatedfits[i];
+    for(int j = 0; j < p; j++) {
+      //Gamma fits estimate the dispersion, so summary.glm() uses t tests; the others use z tests
+      pvals(i, j) = 2 * (fitfamily == GAMMA ? R::pt(pvals(i, j), df, 1, 0) : R::pnorm(pvals(i, j), 0, 1, 1, 0));
+    }
+    for(int e = 0; e < neffects; e++) {
+      effectpvals(i, e) = R::pchisq(effectpvals(i, e), L[e].rows(), 0, 0);
+    }
+  }
+  return(List::create(_["estimates"] = estimates, _["stderrors"] = stderrors, _["pvals"] = pvals,
+                      _["effectpvals"] = effectpvals, _["iterations"] = iterations,
+                      _["converged"] = converged, _["separated"] = separated));
+}
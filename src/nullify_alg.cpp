@@ -57,7 +57,7 @@ void orthogonalize_input(Eigen::MatrixXd& X, int basis_row, const std::vector<bo
 }
 
 
-Eigen::VectorXi orthogonal_initial(const Eigen::MatrixXd& candidatelist, int nTrials) {
+Eigen::VectorXi orthogonal_initial(const Eigen::Ref<const Eigen::MatrixXd>& candidatelist, int nTrials) {
   //Construct a nonsingular design matrix from candidatelist using the nullify procedure
   //Returns a vector of rownumbers indicating which runs from candidatelist to use
   //These rownumbers are not shuffled; you must do that yourself if randomizing the order is important
@@ -6,4 +6,4 @@ int longest_row(const Eigen::MatrixXd& V, const std::vector<bool>& rows_used);
 
 void orthogonalize_input(Eigen::MatrixXd& X, int basis_row, const std::vector<bool>& rows_used);
 
-Eigen::VectorXi orthogonal_initial(const Eigen::MatrixXd& candidatelist, int nTrials);
+Eigen::VectorXi orthogonal_initial(const Eigen::Ref<const Eigen::MatrixXd>& candidatelist, int nTrials);
@@ -1,4 +1,7 @@
 #include <RcppEigen.h>
+#include <numeric>
+#include <algorithm>
+#include "optimalityfunctions.h"
 
 double calculateDOptimality(const Eigen::MatrixXd& currentDesign) {
   Eigen::MatrixXd XtX = currentDesign.transpose()*currentDesign;
@@ -92,14 +95,184 @@ Eigen::MatrixXd rankUpdateValue(Eigen::MatrixXd& vinv, const Eigen::VectorXd& po
 }
 
 void search_candidate_set(const Eigen::MatrixXd& V, const Eigen::MatrixXd& candidatelist_trans,
+                          const Eigen::VectorXd& candidatevariances, const CandidateOrder& candidateorder,
                           const Eigen::VectorXd& designrow,
                           double xVx, int& entryy, bool& found, double& del) {
+  //By Cauchy-Schwarz (c'Vx)^2 <= c'Vc x'Vx, so the delta is at most c'Vc - x'Vx. Candidates are visited
+  //in order of decreasing c'Vc as of the last sort, and no c'Vc has grown by more than the order's slack
+  //since, so the scan stops once the sort key plus the slack falls below the best delta found. Candidates
+  //whose current bound is already too low are skipped. Ties go to the lowest candidate index, matching a
+  //scan in candidate order.
   Eigen::VectorXd yV(candidatelist_trans.rows());
   double newdel = 0;
   int ncols = candidatelist_trans.cols();
-  for (int j = 0; j < ncols; j++) {
+  for (int k = 0; k < ncols; k++) {
+    int j = candidateorder.order[k];
+    double remainingbound = candidateorder.sortkeys(j) + candidateorder.slack;
+    if(remainingbound - xVx + 1e-8*std::max(remainingbound, 1.0) < del) {
+      break;
+    }
+    if(candidatevariances(j) - xVx + 1e-8*std::max(candidatevariances(j), 1.0) < del) {
+      continue;
+    }
     yV = V * candidatelist_trans.col(j);
     newdel = yV.dot(candidatelist_trans.col(j))*(1 - xVx) - xVx + pow(yV.dot(designrow),2);
+    if(newdel > del || (found && newdel == del && j < entryy)) {
+      found = true;
+      entryy = j;
+      del = newdel;
+    }
+  }
+}
+
+void sortCandidateVariances(const Eigen::VectorXd& candidatevariances, CandidateOrder& candidateorder) {
+  candidateorder.order.resize(candidatevariances.size());
+  std::iota(candidateorder.order.begin(), candidateorder.order.end(), 0);
+  std::stable_sort(candidateorder.order.begin(), candidateorder.order.end(),
+                   [&candidatevariances](int a, int b) {return(candidatevariances(a) > candidatevariances(b));});
+  candidateorder.sortkeys = candidatevariances;
+  candidateorder.slack = 0;
+}
+
+void calculateCandidateVariances(const Eigen::MatrixXd& V, const Eigen::Ref<const Eigen::MatrixXd>& candidatelist,
+                                 Eigen::VectorXd& candidatevariances, CandidateOrder& candidateorder) {
+  candidatevariances = (candidatelist*V).cwiseProduct(candidatelist).rowwise().sum();
+  sortCandidateVariances(candidatevariances, candidateorder);
+}
+
+void updateCandidateVariances(const Eigen::MatrixXd& V, const Eigen::MatrixXd& candidatelist_trans,
+                              const Eigen::VectorXd& pointold, const Eigen::VectorXd& pointnew,
+                              Eigen::VectorXd& candidatevariances, CandidateOrder& candidateorder) {
+  //V is the inverse before exchanging pointold for pointnew: each c'Vc changes by the rank-2 Woodbury term.
+  Eigen::VectorXd Vnew = V * pointnew;
+  Eigen::VectorXd Vold = V * pointold;
+  double nVn = Vnew.dot(pointnew);
+  double oVo = Vold.dot(pointold);
+  double nVo = Vnew.dot(pointold);
+  double det = (1 + nVn)*(1 - oVo) + nVo*nVo;
+  Eigen::ArrayXd a = (candidatelist_trans.transpose() * Vnew).array();
+  Eigen::ArrayXd e = (candidatelist_trans.transpose() * Vold).array();
+  candidatevariances.array() -= (a*a*(1 - oVo) + 2*nVo*a*e - e*e*(1 + nVn))/det;
+  //The order is kept until the next pass re-sorts it; widening its slack keeps the scan bound valid.
+  candidateorder.slack = std::max(candidateorder.slack, (candidatevariances - candidateorder.sortkeys).maxCoeff());
+}
+
+double calculateExchangeRatio(const Eigen::MatrixXd& V, const Eigen::VectorXd& designrow,
+                              const Eigen::VectorXd& candidaterow) {
+  //Ratio of the determinant of X'X after exchanging designrow for candidaterow to the current determinant
+  Eigen::VectorXd yV = V * candidaterow;
+  double xVx = designrow.dot(V * designrow);
+  return((1 + yV.dot(candidaterow))*(1 - xVx) + pow(yV.dot(designrow),2));
+}
+
+void search_candidate_set_T(const Eigen::MatrixXd& V, const Eigen::MatrixXd& XtX,
+                            const Eigen::MatrixXd& candidatelist_trans,
+                            const Eigen::VectorXd& candidatenorms, const std::vector<int>& candidateorder,
+                            const Eigen::VectorXd& designrow, double minratio,
+                            int& entryy, bool& found, double& del) {
+  //trace(X'X) is the sum of the squared row norms, so an exchange changes it by ||c||^2 - ||x||^2.
+  //Candidates are visited in order of decreasing norm, so the first non-singular exchange is the best one.
+  double xnorm = designrow.squaredNorm();
+  for (unsigned int j = 0; j < candidateorder.size(); j++) {
+    int entry = candidateorder[j];
+    double newdel = candidatenorms(entry) - xnorm;
+    if(newdel <= del) {
+      break;
+    }
+    //Cheap rejection through the determinant ratio, then confirm on the updated information matrix.
+    if(calculateExchangeRatio(V, designrow, candidatelist_trans.col(entry)) > minratio) {
+      Eigen::MatrixXd XtXnew = XtX + candidatelist_trans.col(entry)*candidatelist_trans.col(entry).transpose() -
+        designrow*designrow.transpose();
+      if(XtXnew.colPivHouseholderQr().isInvertible()) {
+        found = true;
+        entryy = entry;
+        del = newdel;
+        break;
+      }
+    }
+  }
+}
+
+int countEigenvaluesBelow(const Eigen::VectorXd& eigenvalues, const Eigen::VectorXd& qd,
+                          const Eigen::VectorXd& qt, double sigma) {
+  //Counts the eigenvalues of diag(eigenvalues) + qd*qt' + qt*qd' that are below sigma. By Haynsworth
+  //inertia additivity this only needs the inertia of D = diag(eigenvalues) - sigma and of the 2x2 capacitance
+  //matrix S + U'D^-1U, where U = [qd qt] and S = [0 1; 1 0]. Returns -1 if sigma is too close to call.
+  int below = 0;
+  double c11 = 0, c12 = 1, c22 = 0;
+  double scale = std::max(std::fabs(eigenvalues.maxCoeff()), std::fabs(sigma));
+  for (int k = 0; k < eigenvalues.size(); k++) {
+    double dk = eigenvalues(k) - sigma;
+    if(std::fabs(dk) <= 1e-14 * scale) {
+      return(-1);
+    }
+    if(dk < 0) {
+      below++;
+    }
+    c11 += qd(k)*qd(k)/dk;
+    c12 += qd(k)*qt(k)/dk;
+    c22 += qt(k)*qt(k)/dk;
+  }
+  double det = c11*c22 - c12*c12;
+  if(det == 0 || !std::isfinite(det)) {
+    return(-1);
+  }
+  int positive = det < 0 ? 1 : (c11 + c22 > 0 ? 2 : 0);
+  return(below + positive - 1);
+}
+
+double calculateEOptimalityUpdate(const Eigen::VectorXd& eigenvalues, const Eigen::VectorXd& qd,
+                                  const Eigen::VectorXd& qt, double lower) {
+  //Smallest eigenvalue of diag(eigenvalues) + qd*qt' + qt*qd', known to be at least `lower`, found by
+  //bisection on the eigenvalue count. The Rayleigh quotient at the current smallest eigenvector bounds it above.
+  int minindex;
+  eigenvalues.minCoeff(&minindex);
+  double upper = eigenvalues(minindex) + 2*qd(minindex)*qt(minindex);
+  double tol = 1e-13 * std::max(std::fabs(upper), 1.0);
+  upper += tol;
+  if(upper <= lower) {
+    return(lower);
+  }
+  while(upper - lower > tol) {
+    double mid = lower + (upper - lower)/2;
+    int count = countEigenvaluesBelow(eigenvalues, qd, qt, mid);
+    if(count < 0) {
+      count = countEigenvaluesBelow(eigenvalues, qd, qt, mid + tol);
+    }
+    if(count == 0) {
+      lower = mid;
+    } else {
+      upper = mid;
+    }
+  }
+  return(lower + (upper - lower)/2);
+}
+
+void search_candidate_set_E(const Eigen::VectorXd& eigenvalues, const Eigen::MatrixXd& Qtcandidates,
+                            const Eigen::VectorXd& Qtx, const Eigen::VectorXd& Qts, double weight,
+                            int& entryy, bool& found, double& del) {
+  //Exchanging x for c changes the information matrix by d*t' + t*d', with d = c - x and
+  //t = weight*(c + x)/2 + s (s is the off-diagonal GLS contribution of the other rows, zero when unblocked).
+  //Q'd and Q't put the update in the eigenbasis of the current information matrix, so each candidate is
+  //screened in O(p) and only improving candidates have their smallest eigenvalue resolved.
+  Eigen::VectorXd qd(eigenvalues.size());
+  Eigen::VectorXd qt(eigenvalues.size());
+  for (int j = 0; j < Qtcandidates.cols(); j++) {
+    qd = Qtcandidates.col(j) - Qtx;
+    qt = weight*(Qtcandidates.col(j) + Qtx)/2 + Qts;
+    double sigma = del + 1e-12 * std::max(std::fabs(del), 1.0);
+    int count = countEigenvaluesBelow(eigenvalues, qd, qt, sigma);
+    double newdel;
+    if(count < 0) {
+      Eigen::MatrixXd updated = eigenvalues.asDiagonal();
+      updated += qd*qt.transpose() + qt*qd.transpose();
+      Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigensolver(updated, Eigen::EigenvaluesOnly);
+      newdel = eigensolver.eigenvalues().minCoeff();
+    } else if (count == 0) {
+      newdel = calculateEOptimalityUpdate(eigenvalues, qd, qt, sigma);
+    } else {
+      continue;
+    }
     if(newdel > del) {
       found = true;
       entryy = j;
@@ -108,6 +281,49 @@ void search_candidate_set(const Eigen::MatrixXd& V, const Eigen::MatrixXd& candi
   }
 }
 
+void search_candidate_set_G(const Eigen::MatrixXd& V, const Eigen::MatrixXd& XV,
+                            const Eigen::VectorXd& designvariances, const Eigen::MatrixXd& design,
+                            const Eigen::MatrixXd& candidatelist_trans, int row,
+                            int& entryy, bool& found, double& del) {
+  //Exchanging x for c changes each prediction variance x_b'V x_b by the rank-2 Woodbury term
+  //(a^2(1-xVx) + 2ae*cVx - e^2(1+cVc))/det, with a = x_b'Vc and e = x_b'Vx, so the maximum over
+  //the design is found in O(Np) per candidate and abandoned as soon as it reaches del.
+  int nTrials = design.rows();
+  int ncols = candidatelist_trans.cols();
+  Eigen::VectorXd designrow = design.row(row).transpose();
+  Eigen::VectorXd XVx = XV * designrow;
+  double xVx = designvariances(row);
+  Eigen::VectorXd yV(candidatelist_trans.rows());
+  Eigen::MatrixXd temp;
+  for (int j = 0; j < ncols; j++) {
+    yV = V * candidatelist_trans.col(j);
+    double cVc = yV.dot(candidatelist_trans.col(j));
+    double cVx = yV.dot(designrow);
+    double det = (1 + cVc)*(1 - xVx) + cVx*cVx;
+    if(!(det > 0)) {
+      continue;
+    }
+    double newdel = cVc - (cVc*cVc*(1 - xVx) + 2*cVc*cVx*cVx - cVx*cVx*(1 + cVc))/det;
+    for (int b = 0; b < nTrials && newdel < del; b++) {
+      if(b == row) {
+        continue;
+      }
+      double a = XV.row(b).dot(candidatelist_trans.col(j));
+      double e = XVx(b);
+      newdel = std::max(newdel, designvariances(b) - (a*a*(1 - xVx) + 2*a*e*cVx - e*e*(1 + cVc))/det);
+    }
+    if(newdel < del) {
+      temp = design;
+      temp.row(row) = candidatelist_trans.col(j).transpose();
+      if(!isSingular(temp)) {
+        found = true;
+        entryy = j;
+        del = newdel;
+      }
+    }
+  }
+}
+
 //**********************************************************
 //Everything below is for generating blocked optimal designs
 //**********************************************************
@@ -1,3 +1,6 @@
+#ifndef OPTIMALITYFUNCTIONS_H
+#define OPTIMALITYFUNCTIONS_H
+
 #include <RcppEigen.h>
 
 double calculateDOptimality(const Eigen::MatrixXd& currentDesign);
@@ -39,10 +42,52 @@ Eigen::MatrixXd rankUpdateValue(Eigen::MatrixXd& vinv, const Eigen::VectorXd& po
                                 const Eigen::MatrixXd& identity,
                                 Eigen::MatrixXd& f1, Eigen::MatrixXd& f2,Eigen::MatrixXd& f2vinv);
 
+//Order the bounded D-optimal scans visit the candidates in: decreasing c'Vc as of the last sort. Exchanges
+//update c'Vc without re-sorting, so slack holds the largest increase of any c'Vc since the sort.
+struct CandidateOrder {
+  std::vector<int> order;
+  Eigen::VectorXd sortkeys;
+  double slack;
+};
+
 void search_candidate_set(const Eigen::MatrixXd& V, const Eigen::MatrixXd& candidatelist_trans,
+                          const Eigen::VectorXd& candidatevariances, const CandidateOrder& candidateorder,
                           const Eigen::VectorXd& designrow,
                           double xVx, int& entryy, bool& found, double& del);
 
+void sortCandidateVariances(const Eigen::VectorXd& candidatevariances, CandidateOrder& candidateorder);
+
+void calculateCandidateVariances(const Eigen::MatrixXd& V, const Eigen::Ref<const Eigen::MatrixXd>& candidatelist,
+                                 Eigen::VectorXd& candidatevariances, CandidateOrder& candidateorder);
+
+void updateCandidateVariances(const Eigen::MatrixXd& V, const Eigen::MatrixXd& candidatelist_trans,
+                              const Eigen::VectorXd& pointold, const Eigen::VectorXd& pointnew,
+                              Eigen::VectorXd& candidatevariances, CandidateOrder& candidateorder);
+
+double calculateExchangeRatio(const Eigen::MatrixXd& V, const Eigen::VectorXd& designrow,
+                              const Eigen::VectorXd& candidaterow);
+
+void search_candidate_set_T(const Eigen::MatrixXd& V, const Eigen::MatrixXd& XtX,
+                            const Eigen::MatrixXd& candidatelist_trans,
+                            const Eigen::VectorXd& candidatenorms, const std::vector<int>& candidateorder,
+                            const Eigen::VectorXd& designrow, double minratio,
+                            int& entryy, bool& found, double& del);
+
+int countEigenvaluesBelow(const Eigen::VectorXd& eigenvalues, const Eigen::VectorXd& qd,
+                          const Eigen::VectorXd& qt, double sigma);
+
+double calculateEOptimalityUpdate(const Eigen::VectorXd& eigenvalues, const Eigen::VectorXd& qd,
+                                  const Eigen::VectorXd& qt, double lower);
+
+void search_candidate_set_E(const Eigen::VectorXd& eigenvalues, const Eigen::MatrixXd& Qtcandidates,
+                            const Eigen::VectorXd& Qtx, const Eigen::VectorXd& Qts, double weight,
+                            int& entryy, bool& found, double& del);
+
+void search_candidate_set_G(const Eigen::MatrixXd& V, const Eigen::MatrixXd& XV,
+                            const Eigen::VectorXd& designvariances, const Eigen::MatrixXd& design,
+                            const Eigen::MatrixXd& candidatelist_trans, int row,
+                            int& entryy, bool& found, double& del);
+
 //**********************************************************
 //Everything below is for generating blocked optimal designs
 //**********************************************************
@@ -72,3 +117,5 @@ double calculateBlockedAliasTracePseudoInv(const Eigen::MatrixXd& currentDesign,
 bool isSingularBlocked(const Eigen::MatrixXd& currentDesign,const Eigen::MatrixXd& gls);
 
 double calculateBlockedCustomOptimality(const Eigen::MatrixXd& currentDesign, Rcpp::Function customBlockedOpt, const Eigen::MatrixXd& gls);
+
+#endif
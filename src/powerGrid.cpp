@@ -0,0 +1,79 @@
+#include <RcppEigen.h>
+// [[Rcpp::depends(RcppEigen)]]
+#include <vector>
+
+#include "effectTests.h"
+
+using namespace Rcpp;
+
+//`@title powerGrid
+//`@param X The model matrix.
+//`@param V The run covariance matrix, or an empty matrix for independent runs.
+//`@param hypotheses List of the hypothesis matrix L of each term.
+//`@param degrees The denominator degrees of freedom of each term's F test (terms with none get `NA` power).
+//`@param anticoefs The anticipated coefficients, one column per set.
+//`@param alphas The type-I errors.
+//`@return Matrix of F-test powers with one row per term and one column per coefficient set and alpha (coefficient
+//`sets varying fastest). The information matrix X'V^-1X is factored once, and L(X'V^-1X)^-1L' once per term, so
+//`the noncentrality parameters of every coefficient set come from one triangular solve per term. Each power
+//`matches `calculatepower()` with `calcnoncentralparam()`.
+// [[Rcpp::export]]
+Eigen::MatrixXd powerGrid(const Eigen::MatrixXd& X, const Eigen::MatrixXd& V, List hypotheses, NumericVector degrees,
+                          const Eigen::MatrixXd& anticoefs, NumericVector alphas) {
+  int n = X.rows();
+  int p = X.cols();
+  std::vector<Eigen::MatrixXd> L = hypothesisMatrices(hypotheses, p);
+  int terms = L.size();
+  int sets = anticoefs.cols();
+  int nalpha = alphas.size();
+  if(anticoefs.rows() != p) {
+    throw std::runtime_error("Wrong number of anticipated coefficients");
+  }
+  if(degrees.size() != terms) {
+    throw std::runtime_error("Need degrees of freedom for every term");
+  }
+  Eigen::MatrixXd information;
+  if(V.size() == 0) {
+    information = X.transpose() * X;
+  } else {
+    if(V.rows() != n || V.cols() != n) {
+      throw std::runtime_error("Covariance matrix and model matrix have different numbers of runs");
+    }
+    Eigen::LLT<Eigen::MatrixXd> Vchol(V);
+    if(Vchol.info() != Eigen::Success) {
+      throw std::runtime_error("Covariance matrix is not positive definite");
+    }
+    information = X.transpose() * Vchol.solve(X);
+  }
+  Eigen::LLT<Eigen::MatrixXd> informationchol(information);
+  if(informationchol.info() != Eigen::Success) {
+    throw std::runtime_error("Information matrix is singular");
+  }
+  Eigen::MatrixXd covariance = informationchol.solve(Eigen::MatrixXd::Identity(p, p));
+
+  Eigen::MatrixXd power(terms, sets * nalpha);
+  std::vector<double> lambda(sets);
+  for(int t = 0; t < terms; t++) {
+    int q = L[t].rows();
+    if(ISNAN(degrees[t]) || degrees[t] <= 0) {
+      power.row(t).setConstant(NA_REAL);
+      continue;
+    }
+    //lambda = (Lb)'(L(X'V^-1X)^-1L')^-1(Lb) = |G^-1 Lb|^2, with GG' the Cholesky factorization of L(X'V^-1X)^-1L'
+    Eigen::LLT<Eigen::MatrixXd> termchol(L[t] * covariance * L[t].transpose());
+    if(termchol.info() != Eigen::Success) {
+      throw std::runtime_error("Hypothesis matrix is not estimable");
+    }
+    Eigen::MatrixXd whitened = termchol.matrixL().solve(L[t] * anticoefs);
+    for(int s = 0; s < sets; s++) {
+      lambda[s] = whitened.col(s).squaredNorm();
+    }
+    for(int a = 0; a < nalpha; a++) {
+      double critical = R::qf(1 - alphas[a], q, degrees[t], 1, 0);
+      for(int s = 0; s < sets; s++) {
+        power(t, s + a * sets) = 1 - R::pnf(critical, q, degrees[t], lambda[s], 1, 0);
+      }
+    }
+  }
+  return(power);
+}
@@ -0,0 +1,326 @@
+#include <RcppEigen.h>
+// [[Rcpp::depends(RcppEigen)]]
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "effectTests.h"
+#include "threadPool.h"
+
+using namespace Rcpp;
+
+//The linear mixed model y = Xb + Zu + e with one level of random block intercepts, u ~ N(0, gamma*sigma^2) and
+//e ~ N(0, sigma^2), so V = sigma^2*H with H = I + gamma*ZZ'. H is block compound-symmetric, so with m_k runs in
+//block k, H^-1 = I - Z diag(gamma/(1 + m_k*gamma)) Z' and log|H| = sum(log(1 + m_k*gamma)).
+class NestedBlockModel {
+public:
+  NestedBlockModel(const Eigen::MatrixXd& X, const std::vector<int>& blocks, int blockcount) :
+    X(X), blocks(blocks), blocksizes(Eigen::VectorXd::Zero(blockcount)) {
+    for(size_t i = 0; i < blocks.size(); i++) {
+      blocksizes(blocks[i]) += 1;
+    }
+    XtX = X.transpose() * X;
+    blocksumsX = blockSums(X);
+  }
+
+  //Z'M: the sum of the rows of M in each block
+  Eigen::MatrixXd blockSums(const Eigen::MatrixXd& M) const {
+    Eigen::MatrixXd sums = Eigen::MatrixXd::Zero(blocksizes.size(), M.cols());
+    for(int i = 0; i < M.rows(); i++) {
+      sums.row(blocks[i]) += M.row(i);
+    }
+    return(sums);
+  }
+
+  Eigen::VectorXd shrinkageFactors(double gamma) const {
+    return((gamma / (1 + gamma * blocksizes.array())).matrix());
+  }
+
+  //H^-k = I - Z diag((1 - (1 + m_j*gamma)^-k)/m_j) Z', since H^-1 acts on each block's sum by 1/(1 + m_j*gamma)
+  Eigen::VectorXd powerShrinkageFactors(double gamma, int power) const {
+    Eigen::VectorXd factors(blocksizes.size());
+    for(int j = 0; j < blocksizes.size(); j++) {
+      factors(j) = blocksizes(j) > 0 ? -std::expm1(-power * std::log1p(gamma * blocksizes(j))) / blocksizes(j) : 0;
+    }
+    return(factors);
+  }
+
+  //X'H^-1X from the block sums of X, without touching the runs
+  Eigen::MatrixXd information(double gamma) const {
+    return(XtX - blocksumsX.transpose() * shrinkageFactors(gamma).asDiagonal() * blocksumsX);
+  }
+
+  //X'H^-kX
+  Eigen::MatrixXd powerInformation(double gamma, int power) const {
+    return(XtX - blocksumsX.transpose() * powerShrinkageFactors(gamma, power).asDiagonal() * blocksumsX);
+  }
+
+  //H^-k v
+  Eigen::VectorXd powerSolve(double gamma, int power, const Eigen::VectorXd& v) const {
+    Eigen::VectorXd factors = powerShrinkageFactors(gamma, power).cwiseProduct(blockSums(v).col(0));
+    Eigen::VectorXd result = v;
+    for(int i = 0; i < v.size(); i++) {
+      result(i) -= factors(blocks[i]);
+    }
+    return(result);
+  }
+
+  //tr(H^-k)
+  double powerTrace(double gamma, int power) const {
+    return(X.rows() - blocksizes.dot(powerShrinkageFactors(gamma, power)));
+  }
+
+  double logDeterminant(double gamma) const {
+    return((1 + gamma * blocksizes.array()).log().sum());
+  }
+
+  const Eigen::MatrixXd& X;
+  std::vector<int> blocks;
+  Eigen::VectorXd blocksizes;
+  Eigen::MatrixXd XtX;
+  Eigen::MatrixXd blocksumsX;
+};
+
+//The sufficient statistics of one response for the REML profile: X'y, the block sums of y, and y'y.
+struct ResponseSummary {
+  Eigen::VectorXd Xty;
+  Eigen::VectorXd blocksumsy;
+  double yty;
+};
+
+//-2 times the REML log-likelihood with sigma^2 profiled out, up to a constant:
+//log|H| + log|X'H^-1X| + (n - p) log(r'H^-1r), where r is the GLS residual.
+static double remlDeviance(const NestedBlockModel& model, const ResponseSummary& response, double gamma,
+                           Eigen::VectorXd& coefficients, double& rss) {
+  int n = model.X.rows();
+  int p = model.X.cols();
+  Eigen::VectorXd shrinkage = model.shrinkageFactors(gamma);
+  Eigen::LLT<Eigen::MatrixXd> llt(model.information(gamma));
+  Eigen::VectorXd Xthy = response.Xty - model.blocksumsX.transpose() * shrinkage.cwiseProduct(response.blocksumsy);
+  coefficients = llt.solve(Xthy);
+  double yhy = response.yty - shrinkage.dot(response.blocksumsy.cwiseProduct(response.blocksumsy));
+  rss = std::max(yhy - coefficients.dot(Xthy), std::numeric_limits<double>::min());
+  double logdetinformation = 2 * llt.matrixLLT().diagonal().array().log().sum();
+  return(model.logDeterminant(gamma) + logdetinformation + (n - p) * std::log(rss));
+}
+
+//Maximizes the REML likelihood over theta = sqrt(gamma) (the parameterization lme4 uses, bounded below by 0):
+//a grid on the log scale brackets the optimum, which golden section search then refines.
+static double profileVarianceRatio(const NestedBlockModel& model, const ResponseSummary& response) {
+  Eigen::VectorXd coefficients;
+  double rss;
+  const int gridsize = 41;
+  std::vector<double> thetas(gridsize);
+  thetas[0] = 0;
+  for(int i = 1; i < gridsize; i++) {
+    thetas[i] = std::pow(10.0, -3 + 5.0 * (i - 1) / (gridsize - 2));
+  }
+  int best = 0;
+  double bestdeviance = std::numeric_limits<double>::infinity();
+  for(int i = 0; i < gridsize; i++) {
+    double deviance = remlDeviance(model, response, thetas[i] * thetas[i], coefficients, rss);
+    if(deviance < bestdeviance) {
+      bestdeviance = deviance;
+      best = i;
+    }
+  }
+  double lower = thetas[std::max(best - 1, 0)];
+  double upper = thetas[std::min(best + 1, gridsize - 1)];
+  const double golden = (std::sqrt(5.0) - 1) / 2;
+  double a = upper - golden * (upper - lower);
+  double b = lower + golden * (upper - lower);
+  double fa = remlDeviance(model, response, a * a, coefficients, rss);
+  double fb = remlDeviance(model, response, b * b, coefficients, rss);
+  while(upper - lower > 1e-8 * (1 + upper)) {
+    if(fa < fb) {
+      upper = b;
+      b = a;
+      fb = fa;
+      a = upper - golden * (upper - lower);
+      fa = remlDeviance(model, response, a * a, coefficients, rss);
+    } else {
+      lower = a;
+      a = b;
+      fa = fb;
+      b = lower + golden * (upper - lower);
+      fb = remlDeviance(model, response, b * b, coefficients, rss);
+    }
+  }
+  double theta = (lower + upper) / 2;
+  //The grid point wins if the refined interior point is no better (e.g. a boundary fit at theta = 0)
+  if(remlDeviance(model, response, theta * theta, coefficients, rss) > bestdeviance) {
+    theta = thetas[best];
+  }
+  return(theta * theta);
+}
+
+//Satterthwaite degrees of freedom for the contrast l'b: 2 (l'Cl)^2 / (g'Ag), where g is the gradient of l'Cl
+//with respect to the variance components and A is their asymptotic covariance.
+static double satterthwaite(const Eigen::VectorXd& contrast, const Eigen::MatrixXd& covariance,
+                            const Eigen::MatrixXd& dCdtau, const Eigen::MatrixXd& dCdsigma2,
+                            const Eigen::Matrix2d& A) {
+  double variance = contrast.dot(covariance * contrast);
+  Eigen::Vector2d gradient(contrast.dot(dCdtau * contrast), contrast.dot(dCdsigma2 * contrast));
+  return(2 * variance * variance / gradient.dot(A * gradient));
+}
+
+//`@title remlMonteCarlo
+//`@param X The model matrix, which must have full column rank and more rows than columns.
+//`@param responses The simulated responses, one column per simulation.
+//`@param blocks The block (whole plot) of each run, numbered from 1.
+//`@param hypotheses List of the hypothesis matrix of each effect.
+//`@param threads The number of native threads to fit on.
+//`@return List with the REML `estimates`, their `stderrors` and Satterthwaite t-test `pvals` (one row per
+//`simulation), the Satterthwaite F-test `effectpvals` of each effect, and the estimated `varianceratios`. These
+//`match fitting each simulation with lmerTest::lmer() and anova(type = "III"), up to the optimizer tolerances.
+// [[Rcpp::export]]
+List remlMonteCarlo(const Eigen::MatrixXd& X, const Eigen::MatrixXd& responses, IntegerVector blocks,
+                    List hypotheses, int threads) {
+  int n = X.rows();
+  int p = X.cols();
+  int nsim = responses.cols();
+  if(responses.rows() != n || blocks.size() != n) {
+    throw std::runtime_error("Responses, blocks, and model matrix have different numbers of runs");
+  }
+  if(n <= p) {
+    throw std::runtime_error("Model matrix must have more runs than parameters");
+  }
+  std::vector<int> blockindices(n);
+  int blockcount = 0;
+  for(int i = 0; i < n; i++) {
+    if(blocks[i] < 1) {
+      throw std::runtime_error("Blocks must be numbered from 1");
+    }
+    blockindices[i] = blocks[i] - 1;
+    blockcount = std::max(blockcount, (int)blocks[i]);
+  }
+  NestedBlockModel model(X, blockindices, blockcount);
+  std::vector<Eigen::MatrixXd> L = hypothesisMatrices(hypotheses, p);
+  int neffects = L.size();
+  Eigen::MatrixXd estimates(nsim, p);
+  Eigen::MatrixXd stderrors(nsim, p);
+  Eigen::MatrixXd pvals(nsim, p);
+  Eigen::MatrixXd effectpvals(nsim, neffects);
+  Eigen::VectorXd varianceratios(nsim);
+  //Satterthwaite degrees of freedom of each t and F statistic
+  Eigen::MatrixXd tdf(nsim, p);
+  Eigen::MatrixXd Fdf(nsim, neffects);
+  //The fits run on the native thread pool, in blocks so the user can interrupt between them; the statistics are
+  //converted to p-values afterwards on this thread, since the R distribution functions aren't thread-safe
+  const int blocksize = 256;
+  for(int blockstart = 0; blockstart < nsim; blockstart += blocksize) {
+    Rcpp::checkUserInterrupt();
+    parallelFor(threads, blockstart, std::min(nsim, blockstart + blocksize), [&](int begin, int end) {
+      ResponseSummary response;
+      Eigen::VectorXd coefficients;
+      double rss;
+      for(int s = begin; s < end; s++) {
+        const Eigen::VectorXd y = responses.col(s);
+        response.Xty = X.transpose() * y;
+        response.blocksumsy = model.blockSums(y);
+        response.yty = y.squaredNorm();
+        double gamma = profileVarianceRatio(model, response);
+        remlDeviance(model, response, gamma, coefficients, rss);
+        double sigma2 = rss / (n - p);
+        varianceratios(s) = gamma;
+        estimates.row(s) = coefficients.transpose();
+
+        //Covariance of the estimates C = sigma^2 G with G = (X'H^-1X)^-1, and its derivatives with respect to the
+        //block variance tau and the residual variance sigma^2: dC/dtau = W'ZZ'W and dC/dsigma2 = W'W, with
+        //W = V^-1XC = H^-1XG. Everything comes from block sums: Z'H^-1 = diag(e)Z' with e_j = 1/(1 + m_j*gamma),
+        //so Z'W = RG with R = diag(e)Z'X, and W'W = GKG with K = X'H^-2X.
+        Eigen::MatrixXd G = model.information(gamma).llt().solve(Eigen::MatrixXd::Identity(p, p));
+        Eigen::MatrixXd covariance = G * sigma2;
+        Eigen::VectorXd e = (1 + gamma * model.blocksizes.array()).inverse().matrix();
+        Eigen::MatrixXd RG = e.asDiagonal() * model.blocksumsX * G;
+        Eigen::MatrixXd K = model.powerInformation(gamma, 2);
+        Eigen::MatrixXd dCdtau = RG.transpose() * RG;
+        Eigen::MatrixXd dCdsigma2 = G * K * G;
+        //Expected REML information of (tau, sigma^2): I_ij = tr(P V_i P V_j) / 2, with V_tau = ZZ', V_sigma2 = I and
+        //P = V^-1 - V^-1XCX'V^-1 = Q/sigma^2, Q = H^-1 - H^-1XGX'H^-1. The traces tr(PZZ'PZZ') = |Z'QZ|^2/sigma^4,
+        //tr(PZZ'P) = |Z'Q|^2/sigma^4 and tr(P^2) = |Q|^2/sigma^4 expand into p x p and block-sized terms.
+        Eigen::MatrixXd RGRt = RG * (e.asDiagonal() * model.blocksumsX).transpose();
+        Eigen::MatrixXd ZtQZ = Eigen::MatrixXd(e.cwiseProduct(model.blocksizes).asDiagonal()) - RGRt;
+        double ZtQnorm = e.cwiseProduct(e).dot(model.blocksizes) - 2 * e.dot(RGRt.diagonal()) +
+          K.cwiseProduct(dCdtau).sum();
+        double Qnorm = model.powerTrace(gamma, 2) - 2 * G.cwiseProduct(model.powerInformation(gamma, 3)).sum() +
+          dCdsigma2.cwiseProduct(K).sum();
+        double scale = 2 * sigma2 * sigma2;
+        Eigen::Matrix2d reml;
+        reml(0, 0) = ZtQZ.squaredNorm() / scale;
+        reml(0, 1) = reml(1, 0) = ZtQnorm / scale;
+        reml(1, 1) = Qnorm / scale;
+        //lmerTest takes the observed information (a numerical Hessian of the REML deviance) instead:
+        //y'PV_iPV_jPy - tr(PV_iPV_j)/2. With u = H^-1(y - Xb), Py = u/sigma^2, so the quadratic forms are
+        //(Z'u)'(Z'QZ)(Z'u), (Z'u)'(Z'Qu) and u'Qu over sigma^6. The expected information is used when the
+        //observed one isn't positive definite, as when the variance ratio is estimated at its boundary.
+        Eigen::VectorXd u = model.powerSolve(gamma, 1, y - X * coefficients);
+        Eigen::VectorXd Hu = model.powerSolve(gamma, 1, u);
+        Eigen::VectorXd Qu = Hu - model.powerSolve(gamma, 1, X * (G * (X.transpose() * Hu)));
+        Eigen::VectorXd Zu = model.blockSums(u).col(0);
+        double cube = sigma2 * sigma2 * sigma2;
+        Eigen::Matrix2d observed;
+        observed(0, 0) = Zu.dot(ZtQZ * Zu) / cube - reml(0, 0);
+        observed(0, 1) = observed(1, 0) = Zu.dot(model.blockSums(Qu).col(0)) / cube - reml(0, 1);
+        observed(1, 1) = u.dot(Qu) / cube - reml(1, 1);
+        bool positive = observed(0, 0) > 0 && observed.determinant() > 0;
+        Eigen::Matrix2d A = positive ? observed.inverse() : reml.inverse();
+
+        Eigen::VectorXd contrast = Eigen::VectorXd::Zero(p);
+        for(int j = 0; j < p; j++) {
+          contrast.setZero();
+          contrast(j) = 1;
+          double se = std::sqrt(covariance(j, j));
+          double df = satterthwaite(contrast, covariance, dCdtau, dCdsigma2, A);
+          stderrors(s, j) = se;
+          pvals(s, j) = -std::fabs(coefficients(j) / se);
+          tdf(s, j) = df;
+        }
+        //F tests with the Satterthwaite denominator degrees of freedom of Fai and Cornelius (as in lmerTest):
+        //combine the degrees of freedom of the independent contrasts along the eigenvectors of LCL'.
+        for(int effect = 0; effect < neffects; effect++) {
+          int q = L[effect].rows();
+          Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigen(L[effect] * covariance * L[effect].transpose());
+          Eigen::VectorXd projected = eigen.eigenvectors().transpose() * (L[effect] * coefficients);
+          double F = 0;
+          std::vector<double> nu(q);
+          for(int m = 0; m < q; m++) {
+            F += projected(m) * projected(m) / eigen.eigenvalues()(m);
+            nu[m] = satterthwaite(L[effect].transpose() * eigen.eigenvectors().col(m), covariance, dCdtau, dCdsigma2,
+                                  A);
+          }
+          F /= q;
+          //As lmerTest's get_Fstat_ddf(): the mean when the nu are all equal, and 2 if any is at most 2
+          double df = 0;
+          bool equal = true;
+          for(int m = 0; m < q; m++) {
+            df += nu[m] / q;
+            equal = equal && (m == 0 || std::fabs(nu[m] - nu[m - 1]) < 1e-8);
+          }
+          if(!equal) {
+            double E = 0;
+            bool small = false;
+            for(int m = 0; m < q; m++) {
+              small = small || nu[m] <= 2;
+              E += nu[m] / (nu[m] - 2);
+            }
+            df = small ? 2 : 2 * E / (E - q);
+          }
+          effectpvals(s, effect) = F;
+          Fdf(s, effect) = df;
+        }
+      }
+    });
+  }
+  for(int s = 0; s < nsim; s++) {
+    for(int j = 0; j < p; j++) {
+      pvals(s, j) = 2 * R::pt(pvals(s, j), tdf(s, j), 1, 0);
+    }
+    for(int e = 0; e < neffects; e++) {
+      effectpvals(s, e) = R::pf(effectpvals(s, e), L[e].rows(), Fdf(s, e), 0, 0);
+    }
+  }
+  return(List::create(_["estimates"] = estimates, _["stderrors"] = stderrors, _["pvals"] = pvals,
+                      _["effectpvals"] = effectpvals, _["varianceratios"] = varianceratios));
+}
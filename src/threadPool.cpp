@@ -0,0 +1,134 @@
+#include <RcppEigen.h>
+// [[Rcpp::depends(RcppEigen)]]
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <algorithm>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "threadPool.h"
+
+using namespace Rcpp;
+
+class ThreadPool {
+public:
+  explicit ThreadPool(int threads) : stopping(false) {
+    for(int i = 0; i < threads; i++) {
+      workers.push_back(std::thread(&ThreadPool::work, this));
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    available.notify_all();
+    for(size_t i = 0; i < workers.size(); i++) {
+      workers[i].join();
+    }
+  }
+
+  int size() const {
+    return(workers.size());
+  }
+
+  void run(int begin, int end, const std::function<void(int, int)>& body) {
+    //A few chunks per thread balances simulations that take different numbers of iterations
+    int chunks = std::min(end - begin, 4 * size());
+    int remaining = chunks;
+    std::exception_ptr failure;
+    std::mutex done;
+    std::condition_variable finished;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for(int c = 0; c < chunks; c++) {
+        int chunkbegin = begin + (long long)(end - begin) * c / chunks;
+        int chunkend = begin + (long long)(end - begin) * (c + 1) / chunks;
+        tasks.push_back([&, chunkbegin, chunkend]() {
+          try {
+            body(chunkbegin, chunkend);
+          } catch(...) {
+            std::lock_guard<std::mutex> lock(done);
+            if(!failure) {
+              failure = std::current_exception();
+            }
+          }
+          std::lock_guard<std::mutex> lock(done);
+          if(--remaining == 0) {
+            finished.notify_one();
+          }
+        });
+      }
+    }
+    available.notify_all();
+    std::unique_lock<std::mutex> lock(done);
+    finished.wait(lock, [&]() { return(remaining == 0); });
+    if(failure) {
+      std::rethrow_exception(failure);
+    }
+  }
+
+private:
+  void work() {
+    while(true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        available.wait(lock, [this]() { return(stopping || !tasks.empty()); });
+        if(stopping && tasks.empty()) {
+          return;
+        }
+        task = tasks.front();
+        tasks.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()> > tasks;
+  std::mutex mutex;
+  std::condition_variable available;
+  bool stopping;
+};
+
+static std::unique_ptr<ThreadPool> pool;
+#ifndef _WIN32
+static pid_t poolowner = 0;
+#endif
+
+static ThreadPool& threadPool(int threads) {
+#ifndef _WIN32
+  if(pool && poolowner != getpid()) {
+    //A forked child (mclapply, multicore futures) inherits the pool object but not its worker threads, so the
+    //inherited pool can be neither used nor joined: abandon it and start a pool of the child's own
+    (void)pool.release();
+  }
+#endif
+  if(!pool || pool->size() != threads) {
+    pool.reset();
+    pool.reset(new ThreadPool(threads));
+#ifndef _WIN32
+    poolowner = getpid();
+#endif
+  }
+  return(*pool);
+}
+
+void parallelFor(int threads, int begin, int end, const std::function<void(int, int)>& body) {
+  if(end <= begin) {
+    return;
+  }
+  if(threads <= 1 || end - begin == 1) {
+    body(begin, end);
+    return;
+  }
+  threadPool(threads).run(begin, end, body);
+}
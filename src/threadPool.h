@@ -0,0 +1,17 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <RcppEigen.h>
+#include <functional>
+
+//Persistent pool of native worker threads shared by the C++ engines. The thread count comes from R (one unless
+//the caller asked for parallel computation, see native_threads()). The pool is created on first parallel use, kept
+//for later calls, rebuilt when the thread count changes, and replaced in a forked child.
+
+//Runs body(begin, end) over contiguous chunks of [begin, end) on `threads` pool threads (serially on the calling
+//thread when `threads` is 1), returning once every chunk is done. Exceptions thrown by the body are rethrown here.
+//Must be called from the main R thread, and the body must not call the R API (including the R:: distribution
+//functions and unif_rand()).
+void parallelFor(int threads, int begin, int end, const std::function<void(int, int)>& body);
+
+#endif